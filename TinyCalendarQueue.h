@@ -0,0 +1,279 @@
+/*
+ * TinyCalendarQueue.h - A calendar queue deadline store for a TinyScheduler.
+ *
+ * A calendar queue is a hash of deadlines by time, like the days of a desk calendar: bucket i holds
+ * the deadlines falling in [i * width, (i + 1) * width), modulo one "year" of buckets * width
+ * ticks. Arming a slot pushes it onto its day's list. A scheduler pass looks only at the days
+ * between the previous pass and now, so when deadlines are spread evenly (periodic tasks) and each
+ * day holds a couple of them, both arming and finding due tasks are O(1) on average.
+ *
+ * That average depends on the number of days and their width, so the queue tunes both:
+ *  - The number of days in use doubles when there are more than 2 slots per day, and halves when
+ *    there are fewer than 1 per 4 days, up to Days (the next power of two at or above N).
+ *  - The width follows the gaps seen between the deadlines taken out: every 64 due slots, it
+ *    is compared with 3 times the average gap, and changed if it is off by more than a factor of 4.
+ *    Widths are powers of two, so finding a day is a shift, not a division.
+ * Each change rebuilds the calendar, which is O(n).
+ *
+ * Keys are 32-bit offsets from an epoch no later than now, moved forward (with a rebuild) when
+ * they pass 2^30, the same way as TinyRadixHeap, so the 31-bit TinyTask window always fits. As
+ * there, set() also moves an epoch that idle passes have left 2^30 ticks behind now, and places
+ * each deadline by comparing it with now.
+ *
+ * EXAMPLE:
+
+TinyScheduler<1000, TinyCalendarQueue<1000> > scheduler;
+
+ */
+
+#ifndef TinyCalendarQueue_h
+#define TinyCalendarQueue_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+
+#define TINYCALENDAR_TUNE 64                  // due slots between width checks
+#define TINYCALENDAR_REBASE 0x40000000UL      // move the epoch up when keys pass this
+
+// The smallest power of two that is at least n.
+constexpr unsigned long tinyCalendarDays(unsigned long n, unsigned long days = 1) {
+  return days >= n ? days : tinyCalendarDays(n, days * 2);
+}
+
+template <TinySlot N, unsigned long Days = tinyCalendarDays(N)>
+class TinyCalendarQueue {
+
+  static_assert((Days & (Days - 1)) == 0, "TinyCalendarQueue needs a power of two number of days");
+
+  private:
+
+    // Links hold 1 + slot, so that 0 means "none" and a zero-filled calendar is a valid empty one.
+    uint32_t keys[N];                         // deadline of each slot, relative to epoch
+    TinySlot previous[N];                     // the slot before this one on its day
+    TinySlot next[N];                         // the slot after this one on its day
+    uint8_t queued[(N + 7) / 8];              // bit (slot % 8) of queued[slot / 8] is set if slot is queued
+    TinySlot first[Days];                     // the first slot on each day
+    TinySlot count;                           // the number of queued slots
+    unsigned long days;                       // the number of days in use, a power of two
+    uint8_t shift;                            // log2 of the width of a day, in ticks
+    unsigned long epoch;                      // the time that key 0 stands for
+    uint32_t lastKey;                         // the time of the last pass; no key is lower
+    uint32_t lastDue;                         // the latest key taken out, for measuring gaps
+    uint32_t gaps;                            // sum of the gaps since the last width check
+    uint16_t gapCount;                        // due slots since the last width check
+    boolean isQueued(TinySlot slot);
+    void link(TinySlot slot);
+    void unlink(TinySlot slot);
+    void rebuild(unsigned long newDays, uint8_t newShift, unsigned long newEpoch);
+    void catchUp(unsigned long now);          // moves a stale epoch up towards now
+    void resize();                            // changes the number of days to suit count
+    void tune();                              // changes the width to suit the gaps seen
+
+  public:
+
+    constexpr TinyCalendarQueue() :
+      keys{}, previous{}, next{}, queued{}, first{}, count(0), days(1), shift(0), epoch(0), lastKey(0),
+      lastDue(0), gaps(0), gapCount(0) {}
+
+    void set(TinySlot slot, unsigned long deadline, unsigned long now);
+    void clear(TinySlot slot);
+    TinySlot due(unsigned long now, TinySlot* out);
+    long remaining(unsigned long now);
+
+};
+
+template <TinySlot N, unsigned long Days>
+boolean TinyCalendarQueue<N, Days>::isQueued(TinySlot slot) {
+  return (TinyCalendarQueue::queued[slot >> 3] & (1 << (slot & 7))) != 0;
+}
+
+template <TinySlot N, unsigned long Days>
+void TinyCalendarQueue<N, Days>::link(TinySlot slot) {
+  unsigned long day = (TinyCalendarQueue::keys[slot] >> TinyCalendarQueue::shift) & (TinyCalendarQueue::days - 1);
+  TinySlot head = TinyCalendarQueue::first[day];
+  TinyCalendarQueue::previous[slot] = 0;
+  TinyCalendarQueue::next[slot] = head;
+  if (head != 0) TinyCalendarQueue::previous[head - 1] = slot + 1;
+  TinyCalendarQueue::first[day] = slot + 1;
+}
+
+template <TinySlot N, unsigned long Days>
+void TinyCalendarQueue<N, Days>::unlink(TinySlot slot) {
+  TinySlot before = TinyCalendarQueue::previous[slot];
+  TinySlot after = TinyCalendarQueue::next[slot];
+  if (before != 0) {
+    TinyCalendarQueue::next[before - 1] = after;
+  } else {
+    unsigned long day = (TinyCalendarQueue::keys[slot] >> TinyCalendarQueue::shift) & (TinyCalendarQueue::days - 1);
+    TinyCalendarQueue::first[day] = after;
+  }
+  if (after != 0) TinyCalendarQueue::previous[after - 1] = before;
+}
+
+template <TinySlot N, unsigned long Days>
+void TinyCalendarQueue<N, Days>::rebuild(unsigned long newDays, uint8_t newShift, unsigned long newEpoch) {
+  uint32_t move = (uint32_t)(TinyCalendarQueue::epoch - newEpoch);
+  for (unsigned long day = 0; day < newDays; day++) TinyCalendarQueue::first[day] = 0;
+  TinyCalendarQueue::days = newDays;
+  TinyCalendarQueue::shift = newShift;
+  TinyCalendarQueue::epoch = newEpoch;
+  TinyCalendarQueue::lastKey += move;
+  TinyCalendarQueue::lastDue += move;
+  for (TinySlot slot = 0; slot < N; slot++) {
+    if (!TinyCalendarQueue::isQueued(slot)) continue;
+    TinyCalendarQueue::keys[slot] += move;
+    TinyCalendarQueue::link(slot);
+  }
+}
+
+template <TinySlot N, unsigned long Days>
+void TinyCalendarQueue<N, Days>::resize() {
+  unsigned long days = TinyCalendarQueue::days;
+  if (TinyCalendarQueue::count > 2 * days && days < Days) {
+    TinyCalendarQueue::rebuild(days * 2, TinyCalendarQueue::shift, TinyCalendarQueue::epoch);
+  } else if (TinyCalendarQueue::count < days / 4) {
+    TinyCalendarQueue::rebuild(days / 2, TinyCalendarQueue::shift, TinyCalendarQueue::epoch);
+  }
+}
+
+template <TinySlot N, unsigned long Days>
+void TinyCalendarQueue<N, Days>::tune() {
+  uint32_t target = 3 * (TinyCalendarQueue::gaps / TinyCalendarQueue::gapCount);   // Brown's rule of thumb
+  TinyCalendarQueue::gaps = 0;
+  TinyCalendarQueue::gapCount = 0;
+  uint8_t newShift = 0;
+  while (newShift < 30 && (1UL << (newShift + 1)) <= target) newShift++;
+  if (newShift > TinyCalendarQueue::shift + 2 || newShift + 2 < TinyCalendarQueue::shift) {
+    TinyCalendarQueue::rebuild(TinyCalendarQueue::days, newShift, TinyCalendarQueue::epoch);
+  }
+}
+
+/*
+ * Like TinyRadixHeap::catchUp(): the epoch goes up to the earliest key, or to now. The last pass
+ * may have been before the new epoch, but no key is lower than the epoch, so passes start there.
+ */
+template <TinySlot N, unsigned long Days>
+void TinyCalendarQueue<N, Days>::catchUp(unsigned long now) {
+  uint32_t behind = (uint32_t)(now - TinyCalendarQueue::epoch);
+  if (behind < TINYCALENDAR_REBASE) return;
+  uint32_t newKey = behind;                   // the new epoch, as a key from the old one
+  for (TinySlot slot = 0; slot < N; slot++) {
+    if (TinyCalendarQueue::isQueued(slot) && TinyCalendarQueue::keys[slot] < newKey) newKey = TinyCalendarQueue::keys[slot];
+  }
+  if (TinyCalendarQueue::lastKey < newKey) TinyCalendarQueue::lastKey = newKey;
+  if (TinyCalendarQueue::lastDue < newKey) TinyCalendarQueue::lastDue = newKey;
+  TinyCalendarQueue::rebuild(TinyCalendarQueue::days, TinyCalendarQueue::shift, TinyCalendarQueue::epoch + newKey);
+}
+
+template <TinySlot N, unsigned long Days>
+void TinyCalendarQueue<N, Days>::set(TinySlot slot, unsigned long deadline, unsigned long now) {
+  if (TinyCalendarQueue::isQueued(slot)) {    // take it out first, so a rebuild leaves it alone
+    TinyCalendarQueue::unlink(slot);
+    TinyCalendarQueue::queued[slot >> 3] &= (uint8_t)~(1 << (slot & 7));
+    TinyCalendarQueue::count--;
+  }
+  if (TinyCalendarQueue::count == 0) {        // empty: start the keys from now
+    TinyCalendarQueue::epoch = now;
+    TinyCalendarQueue::lastKey = 0;
+    TinyCalendarQueue::lastDue = 0;
+  } else {
+    TinyCalendarQueue::catchUp(now);
+  }
+  int64_t key = (int64_t)(int32_t)(uint32_t)(deadline - now) + (uint32_t)(now - TinyCalendarQueue::epoch);
+  if (key < (int64_t)TinyCalendarQueue::lastKey) {   // before the last pass: start the keys from this deadline
+    TinyCalendarQueue::rebuild(TinyCalendarQueue::days, TinyCalendarQueue::shift, deadline);
+    TinyCalendarQueue::lastKey = 0;
+    TinyCalendarQueue::lastDue = 0;
+    key = 0;
+  }
+  TinyCalendarQueue::keys[slot] = (uint32_t)key;
+  TinyCalendarQueue::link(slot);
+  TinyCalendarQueue::queued[slot >> 3] |= (uint8_t)(1 << (slot & 7));
+  TinyCalendarQueue::count++;
+  TinyCalendarQueue::resize();
+}
+
+template <TinySlot N, unsigned long Days>
+void TinyCalendarQueue<N, Days>::clear(TinySlot slot) {
+  if (!TinyCalendarQueue::isQueued(slot)) return;
+  TinyCalendarQueue::unlink(slot);
+  TinyCalendarQueue::queued[slot >> 3] &= (uint8_t)~(1 << (slot & 7));
+  TinyCalendarQueue::count--;
+  TinyCalendarQueue::resize();
+}
+
+/*
+ * Visits each day from the last pass up to now, at most one year's worth, and takes out every
+ * slot on those days whose key is not after now.
+ */
+template <TinySlot N, unsigned long Days>
+TinySlot TinyCalendarQueue<N, Days>::due(unsigned long now, TinySlot* out) {
+  TinySlot found = 0;
+  if (TinyCalendarQueue::count == 0) {        // empty: start the keys from now
+    TinyCalendarQueue::epoch = now;
+    TinyCalendarQueue::lastKey = 0;
+    TinyCalendarQueue::lastDue = 0;
+    return 0;
+  }
+  TinyCalendarQueue::catchUp(now);
+  uint32_t ahead = (uint32_t)(now - TinyCalendarQueue::epoch) - TinyCalendarQueue::lastKey;
+  if ((int32_t)ahead < 0) return 0;
+  uint32_t nowKey = TinyCalendarQueue::lastKey + ahead;
+  uint32_t fromDay = TinyCalendarQueue::lastKey >> TinyCalendarQueue::shift;
+  uint32_t toDay = nowKey >> TinyCalendarQueue::shift;
+  unsigned long visits = toDay - fromDay >= TinyCalendarQueue::days ? TinyCalendarQueue::days : toDay - fromDay + 1;
+  for (unsigned long i = 0; i < visits; i++) {
+    TinySlot s = TinyCalendarQueue::first[(fromDay + i) & (TinyCalendarQueue::days - 1)];
+    while (s != 0) {
+      TinySlot slot = s - 1;
+      s = TinyCalendarQueue::next[slot];
+      uint32_t key = TinyCalendarQueue::keys[slot];
+      if (key > nowKey) continue;             // a later year
+      TinyCalendarQueue::unlink(slot);
+      TinyCalendarQueue::queued[slot >> 3] &= (uint8_t)~(1 << (slot & 7));
+      TinyCalendarQueue::count--;
+      out[found++] = slot;
+      if (key > TinyCalendarQueue::lastDue) {
+        TinyCalendarQueue::gaps += key - TinyCalendarQueue::lastDue;
+        TinyCalendarQueue::lastDue = key;
+      }
+      if (TinyCalendarQueue::gapCount < 0xFFFF) TinyCalendarQueue::gapCount++;
+    }
+  }
+  TinyCalendarQueue::lastKey = nowKey;
+  if (TinyCalendarQueue::gapCount >= TINYCALENDAR_TUNE) TinyCalendarQueue::tune();   // not while walking the days
+  if (found != 0) TinyCalendarQueue::resize();
+  if (nowKey >= TINYCALENDAR_REBASE) {
+    TinyCalendarQueue::rebuild(TinyCalendarQueue::days, TinyCalendarQueue::shift, TinyCalendarQueue::epoch + nowKey);
+  }
+  return found;
+}
+
+template <TinySlot N, unsigned long Days>
+long TinyCalendarQueue<N, Days>::remaining(unsigned long now) {
+  if (TinyCalendarQueue::count == 0) return -1L;
+  uint32_t fromDay = TinyCalendarQueue::lastKey >> TinyCalendarQueue::shift;
+  boolean found = false;
+  uint32_t smallest = 0;
+  for (unsigned long i = 0; i < TinyCalendarQueue::days && !found; i++) {   // the first day this year with a slot
+    uint32_t day = fromDay + i;
+    for (TinySlot s = TinyCalendarQueue::first[day & (TinyCalendarQueue::days - 1)]; s != 0; s = TinyCalendarQueue::next[s - 1]) {
+      uint32_t key = TinyCalendarQueue::keys[s - 1];
+      if ((key >> TinyCalendarQueue::shift) == day && (!found || key < smallest)) {
+        smallest = key;
+        found = true;
+      }
+    }
+  }
+  if (!found) {                               // nothing this year: look at every slot
+    for (TinySlot slot = 0; slot < N; slot++) {
+      if (!TinyCalendarQueue::isQueued(slot)) continue;
+      if (!found || TinyCalendarQueue::keys[slot] < smallest) smallest = TinyCalendarQueue::keys[slot];
+      found = true;
+    }
+  }
+  int32_t timeLeft = (int32_t)((uint32_t)(TinyCalendarQueue::epoch + smallest) - (uint32_t)now);
+  return timeLeft < 0 ? 0 : timeLeft;
+}
+
+#endif
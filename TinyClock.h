@@ -0,0 +1,164 @@
+/*
+ * TinyClock.h - Time sources for TinyScheduler.
+ *
+ * A clock is a class with a static now() returning the current time in ticks, and two constants:
+ *   BITS - the width of the hardware counter behind it
+ *   HZ   - ticks per second (its resolution), or 0 if that is not known until run time
+ *
+ * The scheduler picks its clock with its third template parameter:
+
+TinyScheduler<4, TinyLinearQueue<4>, TinyMicrosClock> scheduler;
+
+ * TinyTask's rollover arithmetic, (long)(deadline - now), only works when now() uses every bit
+ * of an unsigned long. A counter narrower than that (the 16-bit Timer1 of an AVR, a 24-bit
+ * SysTick) is widened by TinyCounterClock: each reading adds the ticks since the previous reading,
+ * masked to the counter's width, to a full-width total. The mask is a compile-time constant, and
+ * a counter that is already full width is returned as it is. The only cost is that the counter
+ * must be read at least once per rollover, which a scheduler's loop() does anyway.
+ *
+ * Clocks provided:
+ *   TinyMillisClock               Arduino millis() (the default)
+ *   TinyMicrosClock               Arduino micros()
+ *   TinyCounterClock<B, H, read>  a free-running B-bit counter at H Hz, read by calling read()
+ *   TinyMonotonicClock<H>         Linux CLOCK_MONOTONIC, scaled to H Hz (default microseconds)
+ *   TinyTscClock<H>               the x86 time stamp counter; H is the TSC rate if you know it
+ *   TinyVirtualClock              a clock that only moves when told to, for tests and simulation
+ */
+
+#ifndef TinyClock_h
+#define TinyClock_h
+
+#include "Arduino.h"
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define TINYCLOCK_BITS (sizeof(unsigned long) * 8)   // the width of the scheduler's arithmetic
+
+class TinyMillisClock {
+  public:
+    static const uint8_t BITS = TINYCLOCK_BITS;
+    static const unsigned long HZ = 1000UL;
+    static unsigned long now() { return millis(); }
+};
+
+class TinyMicrosClock {
+  public:
+    static const uint8_t BITS = TINYCLOCK_BITS;
+    static const unsigned long HZ = 1000000UL;
+    static unsigned long now() { return micros(); }
+};
+
+/*
+ * A counter that is Bits wide, counting up at Hz, read by Read(). Bits may be anything from 8 to
+ * the width of unsigned long. Counters narrower than that are widened as described above, so
+ * they must be read at least once every 2^Bits ticks.
+ */
+template <uint8_t Bits, unsigned long Hz, unsigned long (*Read)()>
+class TinyCounterClock {
+
+  static_assert(Bits >= 8 && Bits <= TINYCLOCK_BITS, "TinyCounterClock counters are 8 bits to unsigned long wide");
+
+  private:
+
+    static const unsigned long MASK = Bits == TINYCLOCK_BITS ? ~0UL : (1UL << (Bits % TINYCLOCK_BITS)) - 1;
+    static unsigned long last;                // the previous raw reading
+    static unsigned long total;               // the widened time at the previous reading
+
+  public:
+
+    static const uint8_t BITS = Bits;
+    static const unsigned long HZ = Hz;
+
+    static unsigned long now() {
+      if (Bits == TINYCLOCK_BITS) return Read();
+      unsigned long raw = Read() & MASK;
+      TinyCounterClock::total += (raw - TinyCounterClock::last) & MASK;
+      TinyCounterClock::last = raw;
+      return TinyCounterClock::total;
+    }
+
+};
+
+template <uint8_t Bits, unsigned long Hz, unsigned long (*Read)()>
+unsigned long TinyCounterClock<Bits, Hz, Read>::last = 0;
+
+template <uint8_t Bits, unsigned long Hz, unsigned long (*Read)()>
+unsigned long TinyCounterClock<Bits, Hz, Read>::total = 0;
+
+#if defined(__linux__)
+template <unsigned long Hz = 1000000UL>
+class TinyMonotonicClock {
+
+  static_assert(Hz >= 1 && Hz <= 1000000000UL, "TinyMonotonicClock runs at 1 Hz to 1 GHz");
+
+  public:
+
+    static const uint8_t BITS = TINYCLOCK_BITS;
+    static const unsigned long HZ = Hz;
+
+    static unsigned long now() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return TinyMonotonicClock::ticks(ts);
+    }
+
+    // The reading in ticks. The part of a second is scaled in 64 bits, so it stays under Hz even
+    // when Hz doesn't divide 10^9, and the count never steps back at a second boundary.
+    static unsigned long ticks(const struct timespec& ts) {
+      return (unsigned long)ts.tv_sec * Hz + (unsigned long)((uint64_t)ts.tv_nsec * Hz / 1000000000ULL);
+    }
+
+};
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+template <unsigned long Hz = 0>
+class TinyTscClock {
+
+  public:
+
+    static const uint8_t BITS = TINYCLOCK_BITS;
+    static const unsigned long HZ = Hz;       // 0: the TSC rate varies by CPU; give it if you know it
+
+    static unsigned long now() {
+      return (unsigned long)__rdtsc();
+    }
+
+};
+#endif
+
+/*
+ * Time stands still until set() or advance() is called, so tests and simulations decide exactly
+ * when each task becomes due. Ticks are milliseconds unless TINYVIRTUALCLOCK_HZ says otherwise;
+ * define it the same way for every file that includes this one.
+ */
+#ifndef TINYVIRTUALCLOCK_HZ
+#define TINYVIRTUALCLOCK_HZ 1000UL
+#endif
+
+class TinyVirtualClock {
+
+  private:
+
+    static unsigned long& ticks() {           // a function-local static, so this header can be included anywhere
+      static unsigned long current = 0;
+      return current;
+    }
+
+  public:
+
+    static const uint8_t BITS = TINYCLOCK_BITS;
+    static const unsigned long HZ = TINYVIRTUALCLOCK_HZ;
+
+    static unsigned long now() { return TinyVirtualClock::ticks(); }
+    static void set(unsigned long time) { TinyVirtualClock::ticks() = time; }
+    static void advance(unsigned long elapsed) { TinyVirtualClock::ticks() += elapsed; }
+
+};
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ * TinyCyclicExecutive.h - A schedule for a fixed set of periodic functions, worked out by the compiler.
+ *
+ * A TinyCyclicExecutive is given its functions, with their periods and worst-case running times,
+ * as template arguments. The compiler works out the minor frame (the largest time that divides
+ * every period), the major frame (the smallest time every period divides, after which the
+ * schedule repeats), and a table saying which functions run in each minor frame. It also checks
+ * that no minor frame has more work in it than fits, and stops the build if one does.
+ *
+ * At run time loop() only compares the clock with the start of the next frame, and when it is
+ * time, looks up that frame in the table and calls its functions in the order they were listed.
+ * There is no queue and nothing to arm, and every function runs at exactly the same point in
+ * every major frame.
+ *
+ * EXAMPLE:
+
+#include "TinyCyclicExecutive.h"
+
+void readSensors() { ... }    // needs at most 800 us
+void control() { ... }        // 1500 us
+void logStatus() { ... }      // 4000 us
+
+TinyCyclicExecutive<TinyMillisClock,
+  TinyCyclicTask<readSensors, 10, 800>,     //  <-- every 10 ms, costs 800 us
+  TinyCyclicTask<control, 20, 1500>,
+  TinyCyclicTask<logStatus, 100, 4000>
+> executive;                                //  <-- minor frame 10 ms, major frame 100 ms, 10 frames
+
+void loop() {
+  executive.loop();         //  <-- Runs the functions in the frame that has started
+}
+
+ * Periods are in ticks of the Clock (see TinyClock.h); costs are in microseconds, like
+ * TinyTask::setCost(). A cost of 0 means unknown, and isn't checked.
+ *
+ * The table has one entry per minor frame, so periods that are multiples of each other (10, 20,
+ * 100) keep it small. Periods like 7 and 11 give a 1-tick minor frame and a 77-frame table; a
+ * set that needs more than TINYCYCLIC_MAX_FRAMES frames doesn't compile.
+ *
+ * If the sketch falls a whole minor frame or more behind, the frames it missed are skipped, so
+ * every function stays on its place in the schedule, and overruns() counts them. A frame is
+ * never run late to catch up.
+ */
+
+#ifndef TinyCyclicExecutive_h
+#define TinyCyclicExecutive_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+#include "TinyClock.h"
+
+#ifndef TINYCYCLIC_MAX_FRAMES
+#if defined(__AVR__)
+#define TINYCYCLIC_MAX_FRAMES 64              // the table is in RAM; most minor frames in a major frame
+#else
+#define TINYCYCLIC_MAX_FRAMES 1024
+#endif
+#endif
+
+// One function in a TinyCyclicExecutive: called every Period ticks, taking at most Cost microseconds.
+template <TaskToCall Function, unsigned long Period, unsigned long Cost = 0>
+struct TinyCyclicTask {
+  static constexpr TaskToCall FUNCTION = Function;
+  static constexpr unsigned long PERIOD = Period;
+  static constexpr unsigned long COST = Cost;
+};
+
+// The compile-time arithmetic over a list of TinyCyclicTasks; each level handles one task.
+template <class... Tasks> struct TinyCyclicList;
+
+template <>
+struct TinyCyclicList<> {
+  static constexpr bool valid() { return true; }
+  static constexpr unsigned long long divisor(unsigned long long d) { return d; }
+  static constexpr unsigned long long multiple(unsigned long long m) { return m; }
+  static constexpr unsigned long load(unsigned long) { return 0; }
+  static constexpr unsigned long mask(unsigned long, unsigned long) { return 0; }
+};
+
+template <class Task, class... Rest>
+struct TinyCyclicList<Task, Rest...> {
+  static constexpr unsigned long long gcd(unsigned long long a, unsigned long long b) {
+    return b == 0 ? a : gcd(b, a % b);
+  }
+  static constexpr bool valid() {             // every period is at least one tick
+    return Task::PERIOD > 0 && TinyCyclicList<Rest...>::valid();
+  }
+  static constexpr unsigned long long divisor(unsigned long long d) {   // greatest common divisor of d and the periods
+    return TinyCyclicList<Rest...>::divisor(gcd(d, Task::PERIOD));
+  }
+  static constexpr unsigned long long multiple(unsigned long long m) {  // least common multiple of m and the periods
+    return TinyCyclicList<Rest...>::multiple(m / gcd(m, Task::PERIOD) * Task::PERIOD);
+  }
+  static constexpr unsigned long load(unsigned long time) {   // the cost of the frame starting at time
+    return (time % Task::PERIOD == 0 ? Task::COST : 0) + TinyCyclicList<Rest...>::load(time);
+  }
+  static constexpr unsigned long mask(unsigned long time, unsigned long bit) {   // which tasks run at time
+    return (time % Task::PERIOD == 0 ? bit : 0) | TinyCyclicList<Rest...>::mask(time, bit << 1);
+  }
+};
+
+// 0, 1, ... N-1 as a parameter pack, built in halves so long tables don't nest templates deeply.
+template <unsigned int... I> struct TinyCyclicIndices {};
+
+template <class A, class B> struct TinyCyclicJoin;
+template <unsigned int... I, unsigned int... J>
+struct TinyCyclicJoin<TinyCyclicIndices<I...>, TinyCyclicIndices<J...> > {
+  typedef TinyCyclicIndices<I..., (sizeof...(I) + J)...> type;
+};
+
+template <unsigned int N>
+struct TinyCyclicCount {
+  typedef typename TinyCyclicJoin<typename TinyCyclicCount<N / 2>::type,
+                                  typename TinyCyclicCount<N - N / 2>::type>::type type;
+};
+template <> struct TinyCyclicCount<0> { typedef TinyCyclicIndices<> type; };
+template <> struct TinyCyclicCount<1> { typedef TinyCyclicIndices<0> type; };
+
+// The schedule table: for each minor frame, a bit for each task that runs in it.
+template <class List, class Mask, unsigned long Minor, class Indices> struct TinyCyclicTable;
+
+template <class List, class Mask, unsigned long Minor, unsigned int... I>
+struct TinyCyclicTable<List, Mask, Minor, TinyCyclicIndices<I...> > {
+  static constexpr Mask frames[sizeof...(I)] = { (Mask)List::mask(I * Minor, 1)... };
+  static constexpr unsigned long larger(unsigned long a, unsigned long b) { return a > b ? a : b; }
+  static constexpr unsigned long maxLoad(unsigned int first, unsigned int count) {   // the busiest frame, by halves
+    return count == 1 ? List::load(first * Minor)
+         : larger(maxLoad(first, count / 2), maxLoad(first + count / 2, count - count / 2));
+  }
+};
+
+template <class List, class Mask, unsigned long Minor, unsigned int... I>
+constexpr Mask TinyCyclicTable<List, Mask, Minor, TinyCyclicIndices<I...> >::frames[sizeof...(I)];
+
+template <bool Small, class A, class B> struct TinyCyclicPick { typedef A type; };
+template <class A, class B> struct TinyCyclicPick<false, A, B> { typedef B type; };
+
+template <class Clock, class... Tasks>
+class TinyCyclicExecutive {
+
+  typedef TinyCyclicList<Tasks...> List;
+
+  static_assert(sizeof...(Tasks) > 0 && sizeof...(Tasks) <= 32, "TinyCyclicExecutive runs 1 to 32 functions");
+  static_assert(List::valid(), "every TinyCyclicTask period must be at least one tick");
+  static_assert(Clock::HZ != 0, "TinyCyclicExecutive needs a Clock whose resolution is known");
+
+  public:
+
+    static constexpr unsigned long MINOR_FRAME = (unsigned long)List::divisor(0);   // in ticks
+    static constexpr unsigned long MAJOR_FRAME = (unsigned long)List::multiple(1);  // in ticks
+    static constexpr unsigned int FRAMES = (unsigned int)(List::multiple(1) / List::divisor(0));
+    static constexpr uint8_t TASKS = sizeof...(Tasks);
+
+  private:
+
+    static_assert(List::multiple(1) <= 0x7FFFFFFFUL, "the major frame is longer than a clock can count");
+    static_assert(List::multiple(1) / List::divisor(0) <= TINYCYCLIC_MAX_FRAMES,
+                  "the periods need more minor frames than TINYCYCLIC_MAX_FRAMES; use periods that divide each other");
+
+    typedef typename TinyCyclicPick<(TASKS <= 8), uint8_t,
+            typename TinyCyclicPick<(TASKS <= 16), uint16_t, uint32_t>::type>::type Mask;
+    static constexpr unsigned int PLANNED = FRAMES <= TINYCYCLIC_MAX_FRAMES ? FRAMES : 1;   // keeps a failed build quick
+    typedef TinyCyclicTable<List, Mask, MINOR_FRAME, typename TinyCyclicCount<PLANNED>::type> Table;
+
+  public:
+
+    static constexpr unsigned long MAX_LOAD = Table::maxLoad(0, PLANNED);   // microseconds in the busiest frame
+
+  private:
+
+    static_assert((unsigned long long)MAX_LOAD * Clock::HZ <= (unsigned long long)MINOR_FRAME * 1000000ULL,
+                  "the functions in a minor frame take longer than the frame");
+
+    static constexpr TaskToCall functions[sizeof...(Tasks)] = { Tasks::FUNCTION... };
+    uint16_t frame;                           // the minor frame that runs next
+    unsigned long next;                       // the time it starts
+    boolean started;                          // signals that frame 0 has been given a start time
+    unsigned long overrunCount;               // minor frames skipped because loop() was late
+
+  public:
+
+    constexpr TinyCyclicExecutive() : frame(0), next(0), started(false), overrunCount(0) {}
+
+    void start();                             // starts frame 0 now (loop() does this the first time)
+    void start(unsigned long now);            // same, given the current time
+    long remaining();                         // time until the next minor frame starts
+    long remaining(unsigned long now);        // same, given the current time
+    unsigned long overruns();                 // how many minor frames were skipped
+    void loop();                              // call in a loop; runs the frame that has started
+    void loop(unsigned long now);             // same, given the current time
+
+};
+
+template <class Clock, class... Tasks>
+constexpr TaskToCall TinyCyclicExecutive<Clock, Tasks...>::functions[sizeof...(Tasks)];
+
+template <class Clock, class... Tasks>
+void TinyCyclicExecutive<Clock, Tasks...>::start() {
+  TinyCyclicExecutive::start(Clock::now());
+}
+
+template <class Clock, class... Tasks>
+void TinyCyclicExecutive<Clock, Tasks...>::start(unsigned long now) {
+  TinyCyclicExecutive::frame = 0;
+  TinyCyclicExecutive::next = now;
+  TinyCyclicExecutive::started = true;
+}
+
+template <class Clock, class... Tasks>
+long TinyCyclicExecutive<Clock, Tasks...>::remaining() {
+  return TinyCyclicExecutive::remaining(Clock::now());
+}
+
+template <class Clock, class... Tasks>
+long TinyCyclicExecutive<Clock, Tasks...>::remaining(unsigned long now) {
+  if (!TinyCyclicExecutive::started) return 0;
+  long timeLeft = (long)(TinyCyclicExecutive::next - now);
+  return timeLeft > 0 ? timeLeft : 0;
+}
+
+template <class Clock, class... Tasks>
+unsigned long TinyCyclicExecutive<Clock, Tasks...>::overruns() {
+  return TinyCyclicExecutive::overrunCount;
+}
+
+template <class Clock, class... Tasks>
+void TinyCyclicExecutive<Clock, Tasks...>::loop() {
+  TinyCyclicExecutive::loop(Clock::now());
+}
+
+template <class Clock, class... Tasks>
+void TinyCyclicExecutive<Clock, Tasks...>::loop(unsigned long now) {
+  if (!TinyCyclicExecutive::started) TinyCyclicExecutive::start(now);
+  unsigned long late = now - TinyCyclicExecutive::next;
+  if ((long)late < 0) return;                 // the next frame hasn't started
+  if (late >= MINOR_FRAME) {                  // whole frames went by: skip them, keeping the schedule
+    unsigned long skipped = late / MINOR_FRAME;
+    TinyCyclicExecutive::overrunCount += skipped;
+    TinyCyclicExecutive::next += skipped * MINOR_FRAME;
+    TinyCyclicExecutive::frame = (TinyCyclicExecutive::frame + skipped) % FRAMES;
+  }
+  Mask due = Table::frames[TinyCyclicExecutive::frame];
+  if (++TinyCyclicExecutive::frame == FRAMES) TinyCyclicExecutive::frame = 0;
+  TinyCyclicExecutive::next += MINOR_FRAME;
+  for (uint8_t i = 0; due != 0; i++, due >>= 1) {
+    if (due & 1) TinyCyclicExecutive::functions[i]();
+  }
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * TinyDeltaQueue.h - A delta list deadline store for a TinyScheduler, for boards short on RAM.
+ *
+ * This is the classic operating system timer queue. Armed slots are kept in a singly linked list
+ * in deadline order, and each one stores only how many ticks after its predecessor it is due, in
+ * 16 bits. The head's delta counts from the time of the last scheduler pass. A pass subtracts the
+ * elapsed time from the head and pops the entries that reached zero, so it only touches the head
+ * (and the tasks that are due). Inserting and cancelling walk the list, which is the price paid
+ * for 3 bytes per slot on AVR instead of the 4+ bytes of a 32-bit deadline.
+ *
+ * 16 bits covers 65.5 seconds of millis(), or 65.5 ms of micros(). A deadline further away than
+ * that becomes an overflow entry: it is parked 65535 ticks from its place in the list and is
+ * reported due early. The scheduler sees the task is not due yet and arms the slot again, so a
+ * task an hour away costs one extra check about every minute, and no extra RAM.
+ *
+ * EXAMPLE:
+
+TinyScheduler<4, TinyDeltaQueue<4> > scheduler(blink, report);
+
+ */
+
+#ifndef TinyDeltaQueue_h
+#define TinyDeltaQueue_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+
+#define TINYDELTA_MAX 0xFFFFUL                // longest gap that fits in an entry
+
+template <TinySlot N>
+class TinyDeltaQueue {
+
+  private:
+
+    static const TinySlot NONE = (TinySlot)-1;   // end of list
+
+    TinySlot next[N];                         // the slot due after this one, or NONE
+    uint16_t delta[N];                        // ticks after the previous slot (after base, for the head)
+    uint8_t queued[(N + 7) / 8];              // bit (slot % 8) of queued[slot / 8] is set if slot is in the list
+    TinySlot head;                            // the slot due first, or NONE
+    unsigned long base;                       // the time the head's delta counts from
+    void unlink(TinySlot slot);               // removes a slot known to be in the list
+
+  public:
+
+    constexpr TinyDeltaQueue() : next{}, delta{}, queued{}, head(NONE), base(0) {}
+
+    void set(TinySlot slot, unsigned long deadline, unsigned long now);
+    void clear(TinySlot slot);
+    TinySlot due(unsigned long now, TinySlot* out);
+    long remaining(unsigned long now);
+
+};
+
+template <TinySlot N>
+void TinyDeltaQueue<N>::unlink(TinySlot slot) {
+  TinySlot previous = NONE;
+  TinySlot current = TinyDeltaQueue::head;
+  while (current != slot) {
+    previous = current;
+    current = TinyDeltaQueue::next[current];
+  }
+  TinySlot following = TinyDeltaQueue::next[slot];
+  if (following != NONE) {                    // the following slot now counts from our predecessor
+    unsigned long gap = (unsigned long)TinyDeltaQueue::delta[following] + TinyDeltaQueue::delta[slot];
+    TinyDeltaQueue::delta[following] = gap > TINYDELTA_MAX ? TINYDELTA_MAX : gap;   // too far: now an overflow entry
+  }
+  if (previous == NONE) {
+    TinyDeltaQueue::head = following;
+  } else {
+    TinyDeltaQueue::next[previous] = following;
+  }
+  TinyDeltaQueue::queued[slot >> 3] &= (uint8_t)~(1 << (slot & 7));
+}
+
+template <TinySlot N>
+void TinyDeltaQueue<N>::set(TinySlot slot, unsigned long deadline, unsigned long) {
+  if (TinyDeltaQueue::queued[slot >> 3] & (1 << (slot & 7))) TinyDeltaQueue::unlink(slot);
+  if (TinyDeltaQueue::head == NONE) {
+    TinyDeltaQueue::base = deadline;
+  } else if ((long)(deadline - TinyDeltaQueue::base) < 0) {   // earlier than base: count from the new deadline
+    unsigned long gap = TinyDeltaQueue::delta[TinyDeltaQueue::head] + (TinyDeltaQueue::base - deadline);
+    TinyDeltaQueue::delta[TinyDeltaQueue::head] = gap > TINYDELTA_MAX ? TINYDELTA_MAX : gap;
+    TinyDeltaQueue::base = deadline;
+  }
+  unsigned long offset = deadline - TinyDeltaQueue::base;
+  TinySlot previous = NONE;
+  TinySlot current = TinyDeltaQueue::head;
+  while (current != NONE && TinyDeltaQueue::delta[current] <= offset) {
+    offset -= TinyDeltaQueue::delta[current];
+    previous = current;
+    current = TinyDeltaQueue::next[current];
+  }
+  if (offset > TINYDELTA_MAX) offset = TINYDELTA_MAX;   // overflow entry, reported early and armed again
+  if (current != NONE) TinyDeltaQueue::delta[current] -= (uint16_t)offset;
+  TinyDeltaQueue::delta[slot] = (uint16_t)offset;
+  TinyDeltaQueue::next[slot] = current;
+  if (previous == NONE) {
+    TinyDeltaQueue::head = slot;
+  } else {
+    TinyDeltaQueue::next[previous] = slot;
+  }
+  TinyDeltaQueue::queued[slot >> 3] |= (uint8_t)(1 << (slot & 7));
+}
+
+template <TinySlot N>
+void TinyDeltaQueue<N>::clear(TinySlot slot) {
+  if (TinyDeltaQueue::queued[slot >> 3] & (1 << (slot & 7))) TinyDeltaQueue::unlink(slot);
+}
+
+template <TinySlot N>
+TinySlot TinyDeltaQueue<N>::due(unsigned long now, TinySlot* out) {
+  TinySlot count = 0;
+  if (TinyDeltaQueue::head == NONE || (long)(now - TinyDeltaQueue::base) < 0) return 0;
+  unsigned long elapsed = now - TinyDeltaQueue::base;
+  while (TinyDeltaQueue::head != NONE && TinyDeltaQueue::delta[TinyDeltaQueue::head] <= elapsed) {
+    TinySlot slot = TinyDeltaQueue::head;
+    elapsed -= TinyDeltaQueue::delta[slot];
+    TinyDeltaQueue::head = TinyDeltaQueue::next[slot];
+    TinyDeltaQueue::queued[slot >> 3] &= (uint8_t)~(1 << (slot & 7));
+    out[count++] = slot;
+  }
+  if (TinyDeltaQueue::head != NONE) TinyDeltaQueue::delta[TinyDeltaQueue::head] -= (uint16_t)elapsed;
+  TinyDeltaQueue::base = now;
+  return count;
+}
+
+template <TinySlot N>
+long TinyDeltaQueue<N>::remaining(unsigned long now) {
+  if (TinyDeltaQueue::head == NONE) return -1L;
+  long timeLeft = (long)(TinyDeltaQueue::base + TinyDeltaQueue::delta[TinyDeltaQueue::head] - now);
+  return timeLeft < 0 ? 0 : timeLeft;
+}
+
+#endif
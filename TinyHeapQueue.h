@@ -0,0 +1,134 @@
+/*
+ * TinyHeapQueue.h - A binary heap deadline store for a TinyScheduler.
+ *
+ * The armed slots are kept in a binary min-heap ordered by deadline, so finding the next task is
+ * O(1) and arming, moving or cancelling a task is O(log n). Moving a deadline sifts the slot up or
+ * down from where it is, without taking it out of the heap first.
+ *
+ * Deadlines are compared the way TinyTask compares times, (long)(a - b) < 0 in 32 bits, so all
+ * armed deadlines must lie within 2^31 ticks of each other. That is always true for deadlines set
+ * through TinyTask, which are never more than 2^31 - 1 ticks past "now".
+ *
+ * EXAMPLE:
+
+TinyScheduler<64, TinyHeapQueue<64> > scheduler;
+
+ */
+
+#ifndef TinyHeapQueue_h
+#define TinyHeapQueue_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+
+template <TinySlot N>
+class TinyHeapQueue {
+
+  private:
+
+    uint32_t deadlines[N];                    // deadline of each slot
+    TinySlot heap[N];                         // the armed slots, heap[0] is due first
+    TinySlot position[N];                     // 1 + index of the slot in heap[], or 0 if not armed
+    TinySlot size;                            // the number of armed slots
+    boolean earlier(TinySlot a, TinySlot b);  // true if slot a is due before slot b
+    void place(TinySlot index, TinySlot slot);   // puts slot at heap[index]
+    void siftUp(TinySlot index);
+    void siftDown(TinySlot index);
+    void removeAt(TinySlot index);
+
+  public:
+
+    constexpr TinyHeapQueue() : deadlines{}, heap{}, position{}, size(0) {}
+
+    void set(TinySlot slot, unsigned long deadline, unsigned long now);
+    void clear(TinySlot slot);
+    TinySlot due(unsigned long now, TinySlot* out);
+    long remaining(unsigned long now);
+
+};
+
+template <TinySlot N>
+boolean TinyHeapQueue<N>::earlier(TinySlot a, TinySlot b) {
+  return (int32_t)(TinyHeapQueue::deadlines[a] - TinyHeapQueue::deadlines[b]) < 0;
+}
+
+template <TinySlot N>
+void TinyHeapQueue<N>::place(TinySlot index, TinySlot slot) {
+  TinyHeapQueue::heap[index] = slot;
+  TinyHeapQueue::position[slot] = index + 1;
+}
+
+template <TinySlot N>
+void TinyHeapQueue<N>::siftUp(TinySlot index) {
+  TinySlot slot = TinyHeapQueue::heap[index];
+  while (index > 0) {
+    TinySlot parent = (index - 1) / 2;
+    if (!TinyHeapQueue::earlier(slot, TinyHeapQueue::heap[parent])) break;
+    TinyHeapQueue::place(index, TinyHeapQueue::heap[parent]);
+    index = parent;
+  }
+  TinyHeapQueue::place(index, slot);
+}
+
+template <TinySlot N>
+void TinyHeapQueue<N>::siftDown(TinySlot index) {
+  TinySlot slot = TinyHeapQueue::heap[index];
+  unsigned long end = TinyHeapQueue::size < N ? TinyHeapQueue::size : N;   // size never passes N; this lets the compiler see it
+  while (true) {
+    unsigned long child = 2UL * index + 1;
+    if (child >= end) break;
+    unsigned long right = child + 1;
+    if (right < end && TinyHeapQueue::earlier(TinyHeapQueue::heap[right], TinyHeapQueue::heap[child])) child = right;
+    if (!TinyHeapQueue::earlier(TinyHeapQueue::heap[child], slot)) break;
+    TinyHeapQueue::place(index, TinyHeapQueue::heap[child]);
+    index = (TinySlot)child;
+  }
+  TinyHeapQueue::place(index, slot);
+}
+
+template <TinySlot N>
+void TinyHeapQueue<N>::removeAt(TinySlot index) {
+  TinyHeapQueue::position[TinyHeapQueue::heap[index]] = 0;
+  TinySlot last = TinyHeapQueue::heap[--TinyHeapQueue::size];
+  if (index == TinyHeapQueue::size) return;
+  TinyHeapQueue::place(index, last);
+  TinyHeapQueue::siftUp(index);
+  TinyHeapQueue::siftDown(TinyHeapQueue::position[last] - 1);
+}
+
+template <TinySlot N>
+void TinyHeapQueue<N>::set(TinySlot slot, unsigned long deadline, unsigned long) {
+  TinyHeapQueue::deadlines[slot] = (uint32_t)deadline;
+  if (TinyHeapQueue::position[slot] == 0) {
+    TinyHeapQueue::place(TinyHeapQueue::size, slot);
+    TinyHeapQueue::siftUp(TinyHeapQueue::size++);
+  } else {                                    // already armed: move it from where it is
+    TinyHeapQueue::siftUp(TinyHeapQueue::position[slot] - 1);
+    TinyHeapQueue::siftDown(TinyHeapQueue::position[slot] - 1);
+  }
+}
+
+template <TinySlot N>
+void TinyHeapQueue<N>::clear(TinySlot slot) {
+  if (TinyHeapQueue::position[slot] != 0) TinyHeapQueue::removeAt(TinyHeapQueue::position[slot] - 1);
+}
+
+template <TinySlot N>
+TinySlot TinyHeapQueue<N>::due(unsigned long now, TinySlot* out) {
+  TinySlot count = 0;
+  while (TinyHeapQueue::size > 0
+         && (int32_t)(TinyHeapQueue::deadlines[TinyHeapQueue::heap[0]] - (uint32_t)now) <= 0) {
+    out[count++] = TinyHeapQueue::heap[0];
+    TinyHeapQueue::removeAt(0);
+  }
+  return count;
+}
+
+template <TinySlot N>
+long TinyHeapQueue<N>::remaining(unsigned long now) {
+  if (TinyHeapQueue::size == 0) return -1L;
+  int32_t timeLeft = (int32_t)(TinyHeapQueue::deadlines[TinyHeapQueue::heap[0]] - (uint32_t)now);
+  return timeLeft < 0 ? 0 : timeLeft;
+}
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * TinyLinearQueue.h - The default deadline store for a TinyScheduler: a linear scan over a flat table.
+ *
+ * Deadlines are kept structure-of-arrays style: one contiguous array of 32-bit deadlines, indexed by
+ * task slot, and a bit per slot saying whether the slot is armed. Finding the tasks that are due
+ * walks the deadline array in blocks of 8 slots. Blocks with no armed slot are skipped with a
+ * single byte test. Otherwise the expired mask for the block is computed with AVX2, SSE2 or NEON
+ * on hosts that have them, and with plain C++ elsewhere (AVR, most ARM microcontrollers).
+ *
+ * Deadlines are stored as 32 bits even where unsigned long is wider, so a block of 8 fits one AVX2
+ * register. That is enough because TinyTask never arms a deadline more than 2^31 - 1 ticks
+ * ahead, on any board; a deadline has expired when (int32_t)(deadline - now) <= 0.
+ *
+ * Every TinyScheduler storage option offers the same four members:
+ *   set(slot, deadline, now) - arms the slot, or moves its deadline if it is already armed
+ *                              (now is the current time, for stores that keep times relative to an epoch)
+ *   clear(slot)              - disarms the slot; does nothing if it isn't armed
+ *   due(now, out)            - writes every expired slot into out[], disarms them, returns how many
+ *                              (it may also report slots that are not due yet; the scheduler arms them again)
+ *   remaining(now)           - time until the earliest deadline (0 if overdue), or -1 if none armed
+ *
+ * Define TINYTASK_NO_SIMD to force the plain C++ scan.
+ */
+
+#ifndef TinyLinearQueue_h
+#define TinyLinearQueue_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+
+#if !defined(TINYTASK_NO_SIMD)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TINYTASK_SIMD_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TINYTASK_SIMD_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TINYTASK_SIMD_NEON
+#endif
+#endif
+
+template <TinySlot N>
+class TinyLinearQueue {
+
+  private:
+
+    static const TinySlot BLOCKS = (N + 7) / 8;   // slots are scanned 8 at a time
+
+    uint32_t deadlines[BLOCKS * 8];           // deadline of each slot, padded to a whole block
+    uint8_t armed[BLOCKS];                    // bit (slot % 8) of armed[slot / 8] is set if slot is armed
+    static uint8_t expired(const uint32_t* block, uint32_t now);   // bit set for each expired deadline
+
+  public:
+
+    constexpr TinyLinearQueue() : deadlines{}, armed{} {}
+
+    void set(TinySlot slot, unsigned long deadline, unsigned long now);
+    void clear(TinySlot slot);
+    TinySlot due(unsigned long now, TinySlot* out);
+    long remaining(unsigned long now);
+
+};
+
+template <TinySlot N>
+void TinyLinearQueue<N>::set(TinySlot slot, unsigned long deadline, unsigned long) {
+  TinyLinearQueue::deadlines[slot] = (uint32_t)deadline;
+  TinyLinearQueue::armed[slot >> 3] |= (uint8_t)(1 << (slot & 7));
+}
+
+template <TinySlot N>
+void TinyLinearQueue<N>::clear(TinySlot slot) {
+  TinyLinearQueue::armed[slot >> 3] &= (uint8_t)~(1 << (slot & 7));
+}
+
+/*
+ * Returns a bit for each of the 8 deadlines in the block that is at or before now. The caller masks
+ * out the slots that are not armed, so padding and stale deadlines don't matter here.
+ */
+template <TinySlot N>
+uint8_t TinyLinearQueue<N>::expired(const uint32_t* block, uint32_t now) {
+#if defined(TINYTASK_SIMD_AVX2)
+  __m256i left = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)block), _mm256_set1_epi32((int)now));
+  __m256i pending = _mm256_cmpgt_epi32(left, _mm256_setzero_si256());    // (long)(deadline - now) > 0
+  return (uint8_t)~_mm256_movemask_ps(_mm256_castsi256_ps(pending));
+#elif defined(TINYTASK_SIMD_SSE2)
+  __m128i nowx4 = _mm_set1_epi32((int)now);
+  __m128i low = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)block), nowx4);
+  __m128i high = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(block + 4)), nowx4);
+  int pending = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(low, _mm_setzero_si128())))
+    | (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(high, _mm_setzero_si128()))) << 4);
+  return (uint8_t)~pending;
+#elif defined(TINYTASK_SIMD_NEON)
+  static const uint32_t bitsLow[4] = { 1, 2, 4, 8 };
+  static const uint32_t bitsHigh[4] = { 16, 32, 64, 128 };
+  uint32x4_t nowx4 = vdupq_n_u32(now);
+  int32x4_t low = vreinterpretq_s32_u32(vsubq_u32(vld1q_u32(block), nowx4));
+  int32x4_t high = vreinterpretq_s32_u32(vsubq_u32(vld1q_u32(block + 4), nowx4));
+  uint32x4_t bits = vorrq_u32(vandq_u32(vcleq_s32(low, vdupq_n_s32(0)), vld1q_u32(bitsLow)),
+                              vandq_u32(vcleq_s32(high, vdupq_n_s32(0)), vld1q_u32(bitsHigh)));
+  return (uint8_t)vaddvq_u32(bits);
+#else
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    if ((int32_t)(block[i] - now) <= 0) mask |= (uint8_t)(1 << i);
+  }
+  return mask;
+#endif
+}
+
+template <TinySlot N>
+TinySlot TinyLinearQueue<N>::due(unsigned long now, TinySlot* out) {
+  TinySlot count = 0;
+  for (TinySlot block = 0; block < BLOCKS; block++) {
+    uint8_t mask = TinyLinearQueue::armed[block];
+    if (mask == 0) continue;                  // nothing armed in these 8 slots
+    mask &= TinyLinearQueue::expired(&TinyLinearQueue::deadlines[block * 8], (uint32_t)now);
+    if (mask == 0) continue;
+    TinyLinearQueue::armed[block] &= (uint8_t)~mask;
+    for (uint8_t i = 0; mask != 0; i++, mask >>= 1) {
+      if (mask & 1) out[count++] = (TinySlot)(block * 8 + i);
+    }
+  }
+  return count;
+}
+
+template <TinySlot N>
+long TinyLinearQueue<N>::remaining(unsigned long now) {
+  boolean any = false;
+  int32_t shortest = 0;
+  for (TinySlot slot = 0; slot < N; slot++) {
+    if (!(TinyLinearQueue::armed[slot >> 3] & (1 << (slot & 7)))) continue;
+    int32_t timeLeft = (int32_t)(TinyLinearQueue::deadlines[slot] - (uint32_t)now);
+    if (!any || timeLeft < shortest) shortest = timeLeft;
+    any = true;
+  }
+  if (!any) return -1L;
+  return shortest < 0 ? 0 : shortest;
+}
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ * TinyRadixHeap.h - A radix heap deadline store for a TinyScheduler.
+ *
+ * A radix heap works when keys are never inserted below the last key taken out, which is true of
+ * deadlines: a task is never armed for a time before "now". Slots are kept in 33 buckets by the
+ * highest bit in which their key differs from the last key taken out (bucket 0 holds keys equal
+ * to it). Arming a slot is O(1): it is pushed onto one bucket's list. Finding the due tasks pops
+ * bucket 0, and otherwise empties the lowest non-empty bucket into the buckets below it. Each slot
+ * only moves down, at most 32 times over its life, so the cost per task is amortised O(1)-ish and
+ * each pass touches a couple of short lists.
+ *
+ * Keys are 32-bit offsets from an epoch, a point in time no later than "now". Since no deadline
+ * is more than 2^31 ticks ahead, keys stay below 2^32 as long as the last key taken out stays
+ * below 2^30; when it passes that, the epoch is moved up to it and the keys are rebuilt (once every
+ * 12 days of millis(), or every 18 minutes of micros()). Arming a slot for a time before the epoch
+ * (tasks armed before the scheduler first ran) moves the epoch down in the same way.
+ *
+ * Passes that find nothing due don't reach the heap, so set() is also given the time: when the
+ * epoch has fallen 2^30 ticks behind it, the epoch is brought up to the earliest key (or to now)
+ * first. A deadline is then placed by comparing it with now, not with the epoch, so a deadline
+ * 2^31 ticks past a stale epoch is never taken for one in the past.
+ *
+ * EXAMPLE:
+
+TinyScheduler<64, TinyRadixHeap<64> > scheduler;
+
+ */
+
+#ifndef TinyRadixHeap_h
+#define TinyRadixHeap_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+
+#define TINYRADIX_BUCKETS 33                  // bucket 0, plus one per bit of a 32-bit key
+#define TINYRADIX_REBASE 0x40000000UL         // move the epoch up when the last key passes this
+
+template <TinySlot N>
+class TinyRadixHeap {
+
+  private:
+
+    // Links below hold 1 + slot, and bucket holds 1 + bucket number, so that 0 means "none" and a
+    // zero-filled heap is a valid empty one.
+    uint32_t keys[N];                         // deadline of each slot, relative to epoch
+    TinySlot previous[N];                     // the slot before this one in its bucket
+    TinySlot next[N];                         // the slot after this one in its bucket
+    uint8_t bucket[N];                        // the bucket the slot is in
+    TinySlot first[TINYRADIX_BUCKETS];        // the first slot in each bucket
+    unsigned long epoch;                      // the time that key 0 stands for
+    uint32_t last;                            // the last key taken out; no key is lower
+    TinySlot size;                            // the number of slots in the heap
+    uint8_t bucketFor(uint32_t key);          // the bucket a key belongs in, given last
+    void link(TinySlot slot);
+    void unlink(TinySlot slot);
+    void rebase(unsigned long newEpoch);      // moves the epoch and rebuilds every bucket
+    void catchUp(unsigned long now);          // moves a stale epoch up towards now
+
+  public:
+
+    constexpr TinyRadixHeap() :
+      keys{}, previous{}, next{}, bucket{}, first{}, epoch(0), last(0), size(0) {}
+
+    void set(TinySlot slot, unsigned long deadline, unsigned long now);
+    void clear(TinySlot slot);
+    TinySlot due(unsigned long now, TinySlot* out);
+    long remaining(unsigned long now);
+
+};
+
+template <TinySlot N>
+uint8_t TinyRadixHeap<N>::bucketFor(uint32_t key) {
+  uint32_t differ = key ^ TinyRadixHeap::last;
+  if (differ == 0) return 0;
+#if __SIZEOF_INT__ == 4
+  return 32 - __builtin_clz(differ);
+#else
+  return 32 - __builtin_clzl(differ);
+#endif
+}
+
+template <TinySlot N>
+void TinyRadixHeap<N>::link(TinySlot slot) {
+  uint8_t b = TinyRadixHeap::bucketFor(TinyRadixHeap::keys[slot]);
+  TinySlot head = TinyRadixHeap::first[b];
+  TinyRadixHeap::previous[slot] = 0;
+  TinyRadixHeap::next[slot] = head;
+  if (head != 0) TinyRadixHeap::previous[head - 1] = slot + 1;
+  TinyRadixHeap::first[b] = slot + 1;
+  TinyRadixHeap::bucket[slot] = b + 1;
+}
+
+template <TinySlot N>
+void TinyRadixHeap<N>::unlink(TinySlot slot) {
+  TinySlot before = TinyRadixHeap::previous[slot];
+  TinySlot after = TinyRadixHeap::next[slot];
+  if (before != 0) {
+    TinyRadixHeap::next[before - 1] = after;
+  } else {
+    TinyRadixHeap::first[TinyRadixHeap::bucket[slot] - 1] = after;
+  }
+  if (after != 0) TinyRadixHeap::previous[after - 1] = before;
+  TinyRadixHeap::bucket[slot] = 0;
+}
+
+template <TinySlot N>
+void TinyRadixHeap<N>::rebase(unsigned long newEpoch) {
+  for (uint8_t b = 0; b < TINYRADIX_BUCKETS; b++) TinyRadixHeap::first[b] = 0;
+  uint32_t shift = (uint32_t)(TinyRadixHeap::epoch - newEpoch);
+  TinyRadixHeap::epoch = newEpoch;
+  TinyRadixHeap::last = 0;
+  for (TinySlot slot = 0; slot < N; slot++) {
+    if (TinyRadixHeap::bucket[slot] == 0) continue;
+    TinyRadixHeap::keys[slot] += shift;
+    TinyRadixHeap::link(slot);
+  }
+}
+
+/*
+ * The epoch can only move up to the earliest key, so it stays behind now by as much as the
+ * earliest deadline is overdue; in a running sketch that is a pass or two.
+ */
+template <TinySlot N>
+void TinyRadixHeap<N>::catchUp(unsigned long now) {
+  if ((uint32_t)(now - TinyRadixHeap::epoch) < TINYRADIX_REBASE) return;
+  unsigned long newEpoch = now;
+  for (TinySlot slot = 0; slot < N; slot++) {
+    if (TinyRadixHeap::bucket[slot] == 0) continue;
+    unsigned long deadline = TinyRadixHeap::epoch + TinyRadixHeap::keys[slot];
+    if ((int32_t)(uint32_t)(deadline - newEpoch) < 0) newEpoch = deadline;
+  }
+  TinyRadixHeap::rebase(newEpoch);
+}
+
+template <TinySlot N>
+void TinyRadixHeap<N>::set(TinySlot slot, unsigned long deadline, unsigned long now) {
+  if (TinyRadixHeap::bucket[slot] != 0) {
+    TinyRadixHeap::unlink(slot);
+    TinyRadixHeap::size--;
+  }
+  if (TinyRadixHeap::size == 0) {             // empty: start the keys from now
+    TinyRadixHeap::epoch = now;
+    TinyRadixHeap::last = 0;
+  } else {
+    TinyRadixHeap::catchUp(now);
+  }
+  int64_t key = (int64_t)(int32_t)(uint32_t)(deadline - now) + (uint32_t)(now - TinyRadixHeap::epoch);
+  if (key < (int64_t)TinyRadixHeap::last) {   // before the last key: start the keys from this deadline
+    TinyRadixHeap::rebase(deadline);
+    key = 0;
+  }
+  TinyRadixHeap::keys[slot] = (uint32_t)key;
+  TinyRadixHeap::link(slot);
+  TinyRadixHeap::size++;
+}
+
+template <TinySlot N>
+void TinyRadixHeap<N>::clear(TinySlot slot) {
+  if (TinyRadixHeap::bucket[slot] == 0) return;
+  TinyRadixHeap::unlink(slot);
+  TinyRadixHeap::size--;
+}
+
+template <TinySlot N>
+TinySlot TinyRadixHeap<N>::due(unsigned long now, TinySlot* out) {
+  TinySlot count = 0;
+  TinyRadixHeap::catchUp(now);
+  uint32_t ahead = (uint32_t)(now - TinyRadixHeap::epoch) - TinyRadixHeap::last;
+  if ((int32_t)ahead < 0) return 0;           // now is before every key
+  uint32_t nowKey = TinyRadixHeap::last + ahead;
+  while (true) {
+    while (TinyRadixHeap::first[0] != 0) {    // keys equal to last, which is not after now
+      TinySlot slot = TinyRadixHeap::first[0] - 1;
+      TinyRadixHeap::unlink(slot);
+      TinyRadixHeap::size--;
+      out[count++] = slot;
+    }
+    uint8_t b = 1;
+    while (b < TINYRADIX_BUCKETS && TinyRadixHeap::first[b] == 0) b++;
+    if (b == TINYRADIX_BUCKETS) {             // empty: start the keys from now
+      TinyRadixHeap::epoch = now;
+      TinyRadixHeap::last = 0;
+      return count;
+    }
+    uint32_t smallest = 0xFFFFFFFFUL;
+    for (TinySlot s = TinyRadixHeap::first[b]; s != 0; s = TinyRadixHeap::next[s - 1]) {
+      if (TinyRadixHeap::keys[s - 1] < smallest) smallest = TinyRadixHeap::keys[s - 1];
+    }
+    if (smallest > nowKey) break;             // nothing else is due
+    TinyRadixHeap::last = smallest;           // every slot in bucket b now belongs in a lower bucket
+    TinySlot s = TinyRadixHeap::first[b];
+    TinyRadixHeap::first[b] = 0;
+    while (s != 0) {
+      TinySlot following = TinyRadixHeap::next[s - 1];
+      TinyRadixHeap::link(s - 1);
+      s = following;
+    }
+  }
+  if (TinyRadixHeap::last >= TINYRADIX_REBASE) TinyRadixHeap::rebase(TinyRadixHeap::epoch + TinyRadixHeap::last);
+  return count;
+}
+
+template <TinySlot N>
+long TinyRadixHeap<N>::remaining(unsigned long now) {
+  uint32_t smallest;
+  if (TinyRadixHeap::first[0] != 0) {
+    smallest = TinyRadixHeap::last;
+  } else {
+    uint8_t b = 1;
+    while (b < TINYRADIX_BUCKETS && TinyRadixHeap::first[b] == 0) b++;
+    if (b == TINYRADIX_BUCKETS) return -1L;
+    smallest = 0xFFFFFFFFUL;
+    for (TinySlot s = TinyRadixHeap::first[b]; s != 0; s = TinyRadixHeap::next[s - 1]) {
+      if (TinyRadixHeap::keys[s - 1] < smallest) smallest = TinyRadixHeap::keys[s - 1];
+    }
+  }
+  int32_t timeLeft = (int32_t)((uint32_t)(TinyRadixHeap::epoch + smallest) - (uint32_t)now);
+  return timeLeft < 0 ? 0 : timeLeft;
+}
+
+#endif
@@ -0,0 +1,776 @@
+/*
+ * TinyScheduler.h - Runs a fixed set of TinyTasks from a single loop() call.
+ *
+ * A TinyScheduler holds a table of up to N TinyTasks, where N is chosen at compile time. Instead of
+ * calling loop() on every TinyTask, the sketch calls the scheduler's loop() once.
+ *
+ * The constructors are constexpr. A global TinyScheduler, and the global TinyTasks it lists, are
+ * built by the compiler and placed in .data/.bss, so no constructor code runs at startup, no
+ * memory is allocated, and the memory used by the whole schedule shows up in the linker's report.
+ *
+ * EXAMPLE:
+
+#include "TinyScheduler.h"
+
+void blinkTask() {
+  static int state = LOW;
+  digitalWrite(13, state = !state);
+}
+
+void reportTask() {
+  Serial.println(millis());
+}
+
+TinyTask blink(blinkTask);
+TinyTask report(reportTask);
+TinyScheduler<4> scheduler(blink, report);   //  <-- Room for 4 tasks, 2 listed now
+
+void setup() {
+  Serial.begin(9600);
+  pinMode(13, OUTPUT);
+  scheduler.begin();        //  <-- Attaches the listed tasks, before they are armed
+  blink.callEvery(250);
+  report.callEvery(1000);
+}
+
+void loop() {
+  scheduler.loop();         //  <-- Runs every task that is due
+}
+
+ * Tasks can also be added at run time with add(), which returns false if the table is full.
+ * add() also accepts a TinyTimerPool, which adds all of the pool's timers to the table.
+ *
+ * All tasks in a scheduler read the time from the scheduler's clock, the Clock template parameter
+ * (TinyMillisClock by default; see TinyClock.h for the others). TinyTask::useMicros() is ignored in
+ * a scheduler.
+
+TinyScheduler<8, TinyLinearQueue<8>, TinyMicrosClock> scheduler;
+
+ *
+ * The scheduler does not ask each task whether it is due. Each task tells the scheduler its
+ * deadline when it is armed, and the scheduler keeps those deadlines in a separate store (the
+ * Queue template parameter, TinyLinearQueue by default) which finds the due tasks without touching
+ * the TinyTask objects at all. TinyDeltaQueue can be chosen instead where RAM is tight:
+
+TinyScheduler<8, TinyDeltaQueue<8> > scheduler;
+
+ * A constexpr constructor can't change the tasks it lists, so they are attached to the scheduler
+ * by begin(), which must be called in setup() before any of them is armed. Until then a listed
+ * task is a standalone TinyTask: it reads millis() or micros() rather than the scheduler's clock,
+ * and admission control (setAdmission()) only checks it once it is attached. Tasks added with
+ * add() are attached straight away.
+ */
+
+#ifndef TinyScheduler_h
+#define TinyScheduler_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+#include "TinyClock.h"
+#include "TinyTimerPool.h"
+#include "TinyLinearQueue.h"
+#include "TinyDeltaQueue.h"
+#include "TinyHeapQueue.h"
+#include "TinyRadixHeap.h"
+#include "TinyCalendarQueue.h"
+
+#ifndef TINYSCHEDULER_SPREAD_BINS
+#if defined(__AVR__)
+#define TINYSCHEDULER_SPREAD_BINS 32          // load bins spreadPhases() keeps on the stack
+#else
+#define TINYSCHEDULER_SPREAD_BINS 256
+#endif
+#endif
+#define TINYSCHEDULER_SPREAD_STEPS 4096UL     // most steps in a hyperperiod that spreadPhases() will plan
+#define TINYSCHEDULER_NO_SPREAD 0xFFFFFFFFUL  // returned by spreadPhases() when the periods can't be planned
+
+typedef void (*TinyOverloadHandler)(boolean overloaded, long lateness);   // told when overload starts and ends
+typedef void (*TinyAdmissionHandler)(TinyTask& task, unsigned long utilisation);   // told when a task goes over the bound
+
+#define TINYSCHEDULER_ADMIT_ALL 0             // setAdmission(): no check
+#define TINYSCHEDULER_RM 1                    // setAdmission(): the rate-monotonic (Liu and Layland) bound
+#define TINYSCHEDULER_EDF 2                   // setAdmission(): the earliest-deadline-first bound, 100%
+#define TINYSCHEDULER_FULL 1000000UL          // a utilisation of 100%, in parts per million
+
+#ifndef TINYSCHEDULER_BATCHES
+#define TINYSCHEDULER_BATCHES 2               // batch functions addBatch() can register
+#endif
+#ifndef TINYSCHEDULER_BATCH_SIZE
+#define TINYSCHEDULER_BATCH_SIZE 8            // most pointers passed to one call of a batch function
+#endif
+
+typedef void (*TaskBatch)(void* const* pointerParams, uint8_t count);   // runs several tasks' work in one call
+
+template <TinySlot N, class Queue = TinyLinearQueue<N>, class Clock = TinyMillisClock>
+class TinyScheduler : public TinySchedulerBase {
+
+  static_assert(N > 0 && N < (TinySlot)-1, "TinyScheduler size does not fit TINYTASK_SLOT_T");
+
+  private:
+
+    TinyTask* tasks[N];                       // the task table; entries past count are NULL
+    TinySlot count;                           // the number of tasks in the table
+    TinySlot bound;                           // tasks before this one have been attached to the scheduler
+    Queue queue;                              // the deadlines of the armed tasks, by slot
+    TinySlot dueSlots[N];                     // slots found due by the current loop()
+    TinySlot riders[N];                       // after coalesce(): tasks that run with each slot, or NO_SLOT for those tasks
+    TinySlot dispatching;                     // the slot whose riders loop() is running, or NO_SLOT
+    boolean anyArmed;                         // false when no task can be armed, so loop() has nothing to do
+    unsigned long earliest;                   // no armed task is due before this time
+    long lateAverage;                         // moving average of how late tasks run, in 1/16 ticks
+    long overloadAt;                          // average lateness that starts load shedding; 0 for never
+    long recoverAt;                           // average lateness that ends it
+    boolean shedding;                         // signals that degradable tasks are slowed or dropped
+    TinyOverloadHandler overloadHandler;      // told when shedding starts and stops
+    uint8_t admission;                        // the utilisation bound periodic tasks are checked against
+    boolean rejectOverBound;                  // signals that tasks over the bound are refused, not just reported
+    TinyAdmissionHandler admissionHandler;    // told about tasks over the bound
+    TaskToCallTakesPtr batchEach[TINYSCHEDULER_BATCHES];   // functions whose due tasks are run as a batch...
+    TaskBatch batchAll[TINYSCHEDULER_BATCHES];   // ...by these functions
+    uint8_t batches;                          // the number of batch functions registered
+    boolean windowed;                         // signals that a callWithin() task may be waiting to run early
+    boolean passing;                          // signals that loop() is running due tasks...
+    unsigned long passTime;                   // ...at this time
+    unsigned long load(TinyTask* task, long period);   // C/T of one task, in parts per million
+    void bind();                              // attaches tasks that were added since the last call
+    void checkOverload(unsigned long now);    // starts or stops shedding load, from lateAverage
+    void track(TinySlot slot, unsigned long deadline);   // puts a deadline in the queue, moving earliest if needed
+    unsigned long time();                     // the time of the pass being run, or else the clock
+    void run(TinyTask* task, unsigned long now);   // runs (or drops) one due task
+    void measure(TinyTask* task, unsigned long now);   // adds how late a due task is to lateAverage
+    uint8_t batchFor(TinySlot slot);          // the batch function for the task in slot, or batches if none
+    void runBatch(uint8_t batch, TinySlot from, TinySlot due, unsigned long now);   // runs the due tasks of one batch
+    void runEarly(unsigned long now);         // runs the callWithin() tasks whose windows have opened
+    boolean mergeable(TinyTask* task);        // may the task share a queue entry with others like it?
+    void dissolve(TinySlot slot);             // gives every task merged with slot its own queue entry again
+    boolean rides(TinySlot slot);             // true if slot's queue entry is to be left to the run being dispatched
+    static constexpr TinySlot NO_SLOT = (TinySlot)-1;
+
+  public:
+
+    constexpr TinyScheduler() :               // an empty table; use add() to fill it
+      tasks{}, count(0), bound(0), queue(), dueSlots{}, riders{}, dispatching(NO_SLOT), anyArmed(false), earliest(0),
+      lateAverage(0), overloadAt(0), recoverAt(0), shedding(false), overloadHandler(NULL),
+      admission(TINYSCHEDULER_ADMIT_ALL), rejectOverBound(false), admissionHandler(NULL),
+      batchEach{}, batchAll{}, batches(0), windowed(false), passing(false), passTime(0) {}
+
+    // a table holding the listed tasks, built at compile time
+    template <typename... Tasks>
+    constexpr TinyScheduler(TinyTask& first, Tasks&... rest) :
+      tasks{ &first, &rest... }, count(1 + sizeof...(rest)), bound(0), queue(), dueSlots{}, riders{},
+      dispatching(NO_SLOT), anyArmed(false), earliest(0), lateAverage(0), overloadAt(0), recoverAt(0), shedding(false), overloadHandler(NULL),
+      admission(TINYSCHEDULER_ADMIT_ALL), rejectOverBound(false), admissionHandler(NULL),
+      batchEach{}, batchAll{}, batches(0), windowed(false), passing(false), passTime(0) {
+        static_assert(1 + sizeof...(rest) <= N, "more tasks listed than the TinyScheduler can hold");
+    }
+
+    unsigned long now() override;             // the current time, read from Clock
+    unsigned long ticksPerSecond() override;  // Clock::HZ
+    void schedule(TinySlot slot, unsigned long deadline) override;
+    void unschedule(TinySlot slot) override;
+    boolean admit(TinySlot slot, long period) override;
+
+    void begin();                             // attaches the listed tasks; call in setup() before arming them
+    boolean add(TinyTask& task);              // adds a task to the table; false if the table is full
+    template <uint8_t M>
+    boolean add(TinyTimerPool<M>& pool);      // adds all of a pool's timers; false if they don't fit
+    TinySlot size();                          // the number of tasks in the table
+    TinySlot capacity();                      // the most tasks the table can hold
+    void pause();                             // pauses every task, keeping their phases
+    void resume();                            // resumes every paused task
+    void setOverload(long overloadAt, long recoverAt, TinyOverloadHandler handler = NULL);   // enables load shedding
+    boolean overloaded();                     // true while degradable tasks are slowed or dropped
+    long lateness();                          // the average lateness of tasks, in ticks
+    void setAdmission(uint8_t bound, boolean reject, TinyAdmissionHandler handler = NULL);   // checks periodic tasks as they start
+    unsigned long utilisation();              // sum of cost / period of the periodic tasks, in parts per million
+    unsigned long spreadPhases();             // staggers periodic tasks to even out the load; returns the peak load
+    TinySlot coalesce();                      // merges periodic tasks due together into one queue entry each
+    boolean addBatch(TaskToCallTakesPtr each, TaskBatch all);   // runs due tasks that call each with one call to all
+    long remaining();                         // time until the next task is due, or -1 if none armed
+    long remaining(unsigned long now);        // same, given the current time
+    void loop();                              // call in a loop to run every task that is due
+    void loop(unsigned long now);             // same, given the current time
+
+};
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::bind() {
+  while (TinyScheduler::bound < TinyScheduler::count) {
+    TinySlot slot = TinyScheduler::bound++;
+    TinyTask* task = TinyScheduler::tasks[slot];
+    task->scheduler = this;
+    task->slot = slot;
+    if (!task->armed) continue;
+    if (task->periodic && !TinyScheduler::admit(slot, task->interval)) {   // armed before it was attached, so unchecked
+      task->armed = false;
+      continue;
+    }
+    TinyScheduler::schedule(slot, task->timeout);
+  }
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::begin() {
+  TinyScheduler::bind();
+}
+
+template <TinySlot N, class Queue, class Clock>
+boolean TinyScheduler<N, Queue, Clock>::add(TinyTask& task) {
+  if (TinyScheduler::count >= N) return false;
+  TinyScheduler::tasks[TinyScheduler::count++] = &task;
+  TinyScheduler::bind();
+  return true;
+}
+
+template <TinySlot N, class Queue, class Clock>
+template <uint8_t M>
+boolean TinyScheduler<N, Queue, Clock>::add(TinyTimerPool<M>& pool) {
+  if (N - TinyScheduler::count < M) return false;
+  for (uint8_t i = 0; i < M; i++) {
+    TinyScheduler::tasks[TinyScheduler::count++] = &pool.timers[i];
+  }
+  TinyScheduler::bind();
+  return true;
+}
+
+template <TinySlot N, class Queue, class Clock>
+TinySlot TinyScheduler<N, Queue, Clock>::size() {
+  return TinyScheduler::count;
+}
+
+template <TinySlot N, class Queue, class Clock>
+TinySlot TinyScheduler<N, Queue, Clock>::capacity() {
+  return N;
+}
+
+template <TinySlot N, class Queue, class Clock>
+unsigned long TinyScheduler<N, Queue, Clock>::now() {
+  return Clock::now();
+}
+
+template <TinySlot N, class Queue, class Clock>
+unsigned long TinyScheduler<N, Queue, Clock>::ticksPerSecond() {
+  return Clock::HZ;
+}
+
+/*
+ * earliest only ever needs to be a lower bound, so arming a task can only move it earlier, and
+ * moving a task later or cancelling it leaves it alone. The next pass that finds earliest has
+ * passed works out the real earliest deadline again.
+ */
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::schedule(TinySlot slot, unsigned long deadline) {
+  if (TinyScheduler::rides(slot)) return;
+  TinyTaskExtras* extras = TinyScheduler::tasks[slot]->extras;
+  if (extras != NULL && extras->slack != 0) TinyScheduler::windowed = true;
+  TinyScheduler::track(slot, deadline);
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::unschedule(TinySlot slot) {
+  if (TinyScheduler::rides(slot)) return;
+  TinyScheduler::queue.clear(slot);
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::track(TinySlot slot, unsigned long deadline) {
+  TinyScheduler::queue.set(slot, deadline, TinyScheduler::time());
+  if (!TinyScheduler::anyArmed || (long)(deadline - TinyScheduler::earliest) < 0) {
+    TinyScheduler::earliest = deadline;
+    TinyScheduler::anyArmed = true;
+  }
+}
+
+template <TinySlot N, class Queue, class Clock>
+unsigned long TinyScheduler<N, Queue, Clock>::time() {
+  return TinyScheduler::passing ? TinyScheduler::passTime : Clock::now();
+}
+
+/*
+ * The clock is read once, so every task keeps the same time left relative to the others and
+ * resume() brings them all back in step.
+ */
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::pause() {
+  TinyScheduler::bind();
+  unsigned long now = TinyScheduler::now();
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) TinyScheduler::tasks[i]->pause(now);
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::resume() {
+  TinyScheduler::bind();
+  unsigned long now = TinyScheduler::now();
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) TinyScheduler::tasks[i]->resume(now);
+}
+
+/*
+ * Periodic tasks started together all run together on every common multiple of their periods.
+ * spreadPhases() restarts every armed callEvery() task with an offset chosen to spread their
+ * costs (TinyTask::cost(), in microseconds; a task with no cost counts as 1) as evenly as it can.
+ *
+ * Time is divided into steps the size of the greatest common divisor of the periods. Over one
+ * hyperperiod (the least common multiple of the periods) a task with a period of k steps runs in
+ * every k-th step, starting from its offset. Taking the costliest task first, each task gets the
+ * offset whose steps have the least load so far, and is next due at that offset, from 1 to k steps
+ * from now. With more steps than TINYSCHEDULER_SPREAD_BINS, neighbouring steps share a load bin.
+ *
+ * Tasks started with callEveryAligned() keep their deadlines, so they stay on their boundaries;
+ * their load is counted at the steps they already fall in, and the other tasks are spread around them.
+ *
+ * Returns the largest load, in microseconds, of any bin: the worst-case time spent running tasks
+ * in one step (or bin) once the tasks are spread. Returns TINYSCHEDULER_NO_SPREAD, changing
+ * nothing, if the hyperperiod is more than TINYSCHEDULER_SPREAD_STEPS steps long.
+ *
+ * Tasks started with callEveryHz() (whose periods aren't whole ticks), paused tasks and one-shot
+ * tasks are left alone.
+ *
+ * The tasks are sorted in dueSlots, which loop() is using while it runs tasks, so call this from
+ * setup() or between passes of loop(). From inside a task it changes nothing and returns
+ * TINYSCHEDULER_NO_SPREAD.
+ */
+template <TinySlot N, class Queue, class Clock>
+unsigned long TinyScheduler<N, Queue, Clock>::spreadPhases() {
+  if (TinyScheduler::passing) return TINYSCHEDULER_NO_SPREAD;
+  TinyScheduler::bind();
+  TinySlot picked = 0;                        // the tasks to spread are listed in dueSlots
+  unsigned long step = 0;                     // greatest common divisor of the periods
+  uint64_t span = 1;                          // least common multiple of the periods
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) {
+    TinyTask* task = TinyScheduler::tasks[i];
+    if (!task->armed || !task->periodic || task->interval <= 0 || (task->extras != NULL && task->extras->fractionBase != 0)
+        || task->calls >= TinyTask::CALLS_FOR_DELAY) continue;
+    unsigned long period = task->interval;
+    unsigned long a = step, b = period;
+    while (b != 0) { unsigned long r = a % b; a = b; b = r; }
+    step = a;
+    a = (unsigned long)span; b = period;
+    while (b != 0) { unsigned long r = a % b; a = b; b = r; }
+    span = span / a * period;
+    if (span > 0xFFFFFFFFUL) return TINYSCHEDULER_NO_SPREAD;
+    TinyScheduler::dueSlots[picked++] = i;
+  }
+  if (picked == 0) return 0;
+  unsigned long steps = (unsigned long)span / step;
+  if (steps > TINYSCHEDULER_SPREAD_STEPS) return TINYSCHEDULER_NO_SPREAD;
+  unsigned long perBin = (steps + TINYSCHEDULER_SPREAD_BINS - 1) / TINYSCHEDULER_SPREAD_BINS;
+  unsigned long load[TINYSCHEDULER_SPREAD_BINS] = {};
+  unsigned long now = TinyScheduler::now();
+  for (TinySlot i = 0; i < picked; i++) {     // aligned tasks load the steps they are in already
+    TinyTask* task = TinyScheduler::tasks[TinyScheduler::dueSlots[i]];
+    if (!(task->degrade & TinyTask::ALIGNED)) continue;
+    unsigned long cost = task->cost() == 0 ? 1 : task->cost();
+    unsigned long every = (unsigned long)task->interval / step;
+    unsigned long ahead = (long)(task->timeout - now) > 0 ? task->timeout - now : 0;
+    for (unsigned long at = ahead / step % every; at < steps; at += every) load[at / perBin] += cost;
+  }
+  for (TinySlot i = 0; i < picked; i++) {
+    TinySlot costliest = i;                   // selection sort, costliest first
+    for (TinySlot j = i + 1; j < picked; j++) {
+      if (TinyScheduler::tasks[TinyScheduler::dueSlots[j]]->cost()
+          > TinyScheduler::tasks[TinyScheduler::dueSlots[costliest]]->cost()) costliest = j;
+    }
+    TinySlot slot = TinyScheduler::dueSlots[costliest];
+    TinyScheduler::dueSlots[costliest] = TinyScheduler::dueSlots[i];
+    TinyScheduler::dueSlots[i] = slot;
+    TinyTask* task = TinyScheduler::tasks[slot];
+    if (task->degrade & TinyTask::ALIGNED) continue;
+    unsigned long cost = task->cost() == 0 ? 1 : task->cost();
+    unsigned long every = (unsigned long)task->interval / step;
+    unsigned long bestOffset = 0;
+    unsigned long bestPeak = 0xFFFFFFFFUL;
+    for (unsigned long offset = 0; offset < every; offset++) {
+      unsigned long peak = 0;
+      for (unsigned long at = offset; at < steps; at += every) {
+        if (load[at / perBin] > peak) peak = load[at / perBin];
+      }
+      if (peak < bestPeak) {
+        bestPeak = peak;
+        bestOffset = offset;
+      }
+    }
+    for (unsigned long at = bestOffset; at < steps; at += every) load[at / perBin] += cost;
+    task->timeout = now + (bestOffset == 0 ? every : bestOffset) * step;   // offset 0 is a whole period away, as after callEvery()
+    if (task->extras != NULL) task->extras->jittered = 0;
+    task->notifyScheduler();
+  }
+  unsigned long peak = 0;
+  for (unsigned long b = 0; b < TINYSCHEDULER_SPREAD_BINS; b++) {
+    if (load[b] > peak) peak = load[b];
+  }
+  return peak;
+}
+
+/*
+ * Periodic tasks with the same period that are due at the same time stay in step for good, yet
+ * each has its own queue entry, which the scheduler finds due, clears and sets again every period.
+ * coalesce() moves each set of such tasks next to each other in the task table and keeps only
+ * the first in the queue. When it is due, loop() runs it and the tasks after it in one go, so a
+ * set of ten 10 ms tasks costs one queue operation per period instead of ten.
+ *
+ * Tasks that can be merged are armed callEvery() or callEveryAligned() tasks without jitter.
+ * Tasks that aren't merged keep their order in the table, and merged tasks keep theirs after the
+ * first one; since tasks due together run in table order, this can change which of two tasks
+ * due together runs first. Returns the number of queue entries saved.
+ *
+ * A merged task that is cancelled, paused or given a new period or deadline, other than by its
+ * own run, splits its set back into separate tasks; call coalesce() again to merge them once more.
+ * Call it from setup(), or between passes of loop(), but not from inside a task.
+ */
+template <TinySlot N, class Queue, class Clock>
+TinySlot TinyScheduler<N, Queue, Clock>::coalesce() {
+  TinyScheduler::bind();
+  TinySlot merged = 0;
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) TinyScheduler::riders[i] = 0;
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) {
+    TinyTask* first = TinyScheduler::tasks[i];
+    if (!TinyScheduler::mergeable(first)) continue;
+    TinySlot next = i + 1;                    // where the next task in step with first goes
+    for (TinySlot k = i + 1; k < TinyScheduler::count; k++) {
+      TinyTask* task = TinyScheduler::tasks[k];
+      if (!TinyScheduler::mergeable(task) || task->interval != first->interval || task->timeout != first->timeout) continue;
+      for (TinySlot m = k; m > next; m--) TinyScheduler::tasks[m] = TinyScheduler::tasks[m - 1];
+      TinyScheduler::tasks[next++] = task;
+    }
+    TinyScheduler::riders[i] = next - i - 1;
+    for (TinySlot j = i + 1; j < next; j++) TinyScheduler::riders[j] = NO_SLOT;
+    merged += TinyScheduler::riders[i];
+    i = next - 1;
+  }
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) {   // tasks have moved, so the queue starts again
+    TinyScheduler::tasks[i]->slot = i;
+    TinyScheduler::queue.clear(i);
+  }
+  TinyScheduler::anyArmed = false;
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) {
+    TinyTask* task = TinyScheduler::tasks[i];
+    if (task->armed && TinyScheduler::riders[i] != NO_SLOT) TinyScheduler::track(i, task->timeout);
+  }
+  return merged;
+}
+
+template <TinySlot N, class Queue, class Clock>
+boolean TinyScheduler<N, Queue, Clock>::mergeable(TinyTask* task) {
+  return task->armed && task->periodic && task->interval > 0
+      && (task->extras == NULL || (task->extras->fractionBase == 0 && task->extras->jitter == 0))
+      && task->calls != TinyTask::CALLS_NOTHING && task->calls < TinyTask::CALLS_FOR_DELAY;
+}
+
+/*
+ * While loop() runs a merged set, the tasks in it re-arm themselves as usual; the first one's new
+ * deadline goes in the queue and the others' are ignored, and loop() checks they all still agree
+ * once the set has run. Any other change to a merged task splits up its set.
+ */
+template <TinySlot N, class Queue, class Clock>
+boolean TinyScheduler<N, Queue, Clock>::rides(TinySlot slot) {
+  if (TinyScheduler::riders[slot] == 0) return false;
+  TinySlot first = TinyScheduler::dispatching;
+  if (first != NO_SLOT && slot >= first && slot - first <= TinyScheduler::riders[first]) {
+    return TinyScheduler::riders[slot] == NO_SLOT;
+  }
+  TinyScheduler::dissolve(slot);
+  return false;
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::dissolve(TinySlot slot) {
+  TinySlot first = slot;
+  while (TinyScheduler::riders[first] == NO_SLOT) first--;
+  TinySlot last = first + TinyScheduler::riders[first];
+  TinyScheduler::riders[first] = 0;
+  for (TinySlot i = first + 1; i <= last; i++) {
+    TinyScheduler::riders[i] = 0;
+    if (TinyScheduler::tasks[i]->armed) TinyScheduler::track(i, TinyScheduler::tasks[i]->timeout);
+  }
+}
+
+/*
+ * Tip: Use this to find out how long the processor can sleep before the next task is due.
+ */
+template <TinySlot N, class Queue, class Clock>
+long TinyScheduler<N, Queue, Clock>::remaining() {
+  return TinyScheduler::remaining(TinyScheduler::now());
+}
+
+template <TinySlot N, class Queue, class Clock>
+long TinyScheduler<N, Queue, Clock>::remaining(unsigned long now) {
+  TinyScheduler::bind();
+  return TinyScheduler::queue.remaining(now);
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::loop() {
+  if (!TinyScheduler::anyArmed && TinyScheduler::bound == TinyScheduler::count) return;   // don't even read the clock
+  TinyScheduler::loop(TinyScheduler::now());
+}
+
+/*
+ * The time is read once per pass, and the same value is used to find the due tasks, to run them
+ * and to work out their next deadlines.
+ *
+ * Most passes find nothing due. The scheduler remembers a time before which nothing can be due,
+ * so those passes end after a single compare, without looking at the queue.
+ *
+ * The queue disarms the slots it reports as due. Each due task's loop() then runs it and tells
+ * the scheduler its next deadline, if it has one. A queue may report a slot before it is due (see
+ * TinyDeltaQueue); such a task is simply armed in the queue again with its real deadline.
+ */
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::loop(unsigned long now) {
+  if (TinyScheduler::bound < TinyScheduler::count) TinyScheduler::bind();
+  if (!TinyScheduler::anyArmed || (long)(TinyScheduler::earliest - now) > 0) return;   // the idle path
+  TinySlot due = TinyScheduler::queue.due(now, TinyScheduler::dueSlots);
+  TinyScheduler::passing = true;              // tasks re-arming themselves use this pass's time
+  TinyScheduler::passTime = now;
+  for (TinySlot i = 0; i < due; i++) {
+    TinySlot slot = TinyScheduler::dueSlots[i];
+    if (slot == NO_SLOT) continue;            // already run in a batch
+    TinyTask* task = TinyScheduler::tasks[slot];
+    if (!task->armed) continue;
+    uint8_t batch;
+    if ((long)(task->timeout - now) > 0) {
+      TinyScheduler::queue.set(slot, task->timeout, now);
+    } else if (TinyScheduler::batches > 0 && (batch = TinyScheduler::batchFor(slot)) < TinyScheduler::batches) {
+      TinyScheduler::runBatch(batch, i, due, now);
+    } else if (TinyScheduler::riders[slot] == 0) {
+      TinyScheduler::run(task, now);
+    } else {                                  // a set merged by coalesce(): run them all, then check they agree
+      TinySlot last = slot + TinyScheduler::riders[slot];
+      TinyScheduler::dispatching = slot;
+      TinyScheduler::run(task, now);
+      for (TinySlot j = slot + 1; j <= last; j++) {
+        TinyTask* rider = TinyScheduler::tasks[j];
+        if (rider->armed && (long)(rider->timeout - now) <= 0) TinyScheduler::run(rider, now);
+      }
+      TinyScheduler::dispatching = NO_SLOT;
+      for (TinySlot j = slot + 1; j <= last; j++) {
+        TinyTask* rider = TinyScheduler::tasks[j];
+        if (rider->armed != task->armed || (task->armed && (rider->timeout != task->timeout
+            || rider->interval != task->interval || !TinyScheduler::mergeable(rider) || !TinyScheduler::mergeable(task)))) {
+          TinyScheduler::dissolve(slot);
+          break;
+        }
+      }
+    }
+  }
+  if (TinyScheduler::windowed && due > 0) TinyScheduler::runEarly(now);
+  TinyScheduler::passing = false;
+  if (TinyScheduler::overloadAt > 0 && due > 0) TinyScheduler::checkOverload(now);
+  long timeLeft = TinyScheduler::queue.remaining(now);
+  TinyScheduler::anyArmed = timeLeft >= 0;
+  TinyScheduler::earliest = now + timeLeft;
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::run(TinyTask* task, unsigned long now) {
+  TinyScheduler::measure(task, now);
+  if (TinyScheduler::shedding && (task->degrade & TinyTask::DEGRADE) == TINYTASK_DROP && task->periodic) {
+    task->skip(now);
+  } else {
+    task->loop(now);
+  }
+}
+
+/*
+ * A callWithin() task is in the queue for the end of its window, so that is the only pass it
+ * forces. On any other pass that runs tasks the processor is awake anyway, so every task whose
+ * window has opened runs then too, and needs no wakeup of its own.
+ */
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::runEarly(unsigned long now) {
+  TinyScheduler::windowed = false;
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) {
+    TinyTask* task = TinyScheduler::tasks[i];
+    TinyTaskExtras* extras = task->extras;
+    if (!task->armed || extras == NULL || extras->slack == 0) continue;
+    if ((long)(now - (task->timeout - extras->slack)) < 0) {   // its window hasn't opened
+      TinyScheduler::windowed = true;
+      continue;
+    }
+    task->timeout = now;                      // due now, so loop() runs it and takes it out of the queue
+    task->loop(now);
+  }
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::measure(TinyTask* task, unsigned long now) {
+  if (TinyScheduler::overloadAt == 0) return;
+  long late = (long)(now - task->timeout);
+  if (late > 0x7FFFFFL) late = 0x7FFFFFL;     // keeps late * 16 in range
+  TinyScheduler::lateAverage += (late * 16 - TinyScheduler::lateAverage) / 8;
+}
+
+/*
+ * Many tasks often share one function and differ only in their pointer, like the three LEDs of
+ * the TaskWithPointerArgument example. addBatch() registers a second function that does the work
+ * of several of them at once: when tasks that call each are due in the same pass, loop() calls
+ * all once with all of their pointers (up to TINYSCHEDULER_BATCH_SIZE at a time) instead of
+ * calling each once per task. The batch runs where the first of those tasks would have run.
+ * all is called even when only one such task is due.
+ *
+ * Each task is still re-armed as usual. Tasks that are timed with timeCalls(), being dropped by
+ * load shedding, or merged by coalesce() are run on their own. Returns false if
+ * TINYSCHEDULER_BATCHES functions are already registered.
+ */
+template <TinySlot N, class Queue, class Clock>
+boolean TinyScheduler<N, Queue, Clock>::addBatch(TaskToCallTakesPtr each, TaskBatch all) {
+  for (uint8_t b = 0; b < TinyScheduler::batches; b++) {
+    if (TinyScheduler::batchEach[b] == each) {
+      TinyScheduler::batchAll[b] = all;
+      return true;
+    }
+  }
+  if (TinyScheduler::batches == TINYSCHEDULER_BATCHES) return false;
+  TinyScheduler::batchEach[TinyScheduler::batches] = each;
+  TinyScheduler::batchAll[TinyScheduler::batches++] = all;
+  return true;
+}
+
+template <TinySlot N, class Queue, class Clock>
+uint8_t TinyScheduler<N, Queue, Clock>::batchFor(TinySlot slot) {
+  TinyTask* task = TinyScheduler::tasks[slot];
+  if (task->calls != TinyTask::CALLS_POINTER || task->timed || TinyScheduler::riders[slot] != 0
+      || (TinyScheduler::shedding && (task->degrade & TinyTask::DEGRADE) == TINYTASK_DROP && task->periodic)) return TinyScheduler::batches;
+  uint8_t b = 0;
+  while (b < TinyScheduler::batches && TinyScheduler::batchEach[b] != task->taskToCallTakesPtr) b++;
+  return b;
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::runBatch(uint8_t batch, TinySlot from, TinySlot due, unsigned long now) {
+  void* pointers[TINYSCHEDULER_BATCH_SIZE];
+  uint8_t count = 0;
+  for (TinySlot i = from; i < due; i++) {
+    TinySlot slot = TinyScheduler::dueSlots[i];
+    if (slot == NO_SLOT || TinyScheduler::batchFor(slot) != batch) continue;
+    TinyTask* task = TinyScheduler::tasks[slot];
+    if (!task->armed || (long)(task->timeout - now) > 0) continue;
+    TinyScheduler::dueSlots[i] = NO_SLOT;     // so loop() passes over it
+    TinyScheduler::measure(task, now);
+    task->advance(now);
+    task->notifyScheduler();
+    pointers[count++] = task->pointerParam;
+    if (count == TINYSCHEDULER_BATCH_SIZE) {
+      TinyScheduler::batchAll[batch](pointers, count);
+      count = 0;
+    }
+  }
+  if (count > 0) TinyScheduler::batchAll[batch](pointers, count);
+}
+
+/*
+ * Every task the scheduler runs adds how late it was to a moving average (each new value counts
+ * for 1/8). When the average passes overloadAt ticks the scheduler starts shedding load: tasks
+ * marked TINYTASK_STRETCH run half as often, and runs of tasks marked TINYTASK_DROP are skipped.
+ * When the average falls back below recoverAt, the stretched tasks get their periods back and
+ * nothing more is dropped. Both changes are reported to the handler, if one was given.
+ *
+ * Only the tasks that were actually stretched are sped up again. A task whose period couldn't be
+ * doubled, one re-armed or given a new period while overloaded, and one marked TINYTASK_STRETCH
+ * while overloaded all keep the period they have.
+ *
+ * Set recoverAt well below overloadAt, so the scheduler doesn't flip between the two.
+ */
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::setOverload(long overloadAt, long recoverAt, TinyOverloadHandler handler) {
+  TinyScheduler::overloadAt = overloadAt < 0 ? 0 : overloadAt;
+  TinyScheduler::recoverAt = recoverAt;
+  TinyScheduler::overloadHandler = handler;
+  TinyScheduler::lateAverage = 0;
+}
+
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::checkOverload(unsigned long now) {
+  long average = TinyScheduler::lateAverage / 16;
+  if (TinyScheduler::shedding ? average > TinyScheduler::recoverAt : average <= TinyScheduler::overloadAt) return;
+  TinyScheduler::shedding = !TinyScheduler::shedding;
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) {
+    TinyTask* task = TinyScheduler::tasks[i];
+    if (TinyScheduler::shedding) {
+      if ((task->degrade & TinyTask::DEGRADE) == TINYTASK_STRETCH && task->scale(2, 1, now)) task->degrade |= TinyTask::STRETCHED;
+    } else if (task->degrade & TinyTask::STRETCHED) {
+      task->degrade &= ~TinyTask::STRETCHED;
+      task->scale(1, 2, now);
+    }
+  }
+  if (TinyScheduler::overloadHandler != NULL) TinyScheduler::overloadHandler(TinyScheduler::shedding, average);
+}
+
+/*
+ * Utilisation is the fraction of the processor's time the periodic tasks need: the sum, over
+ * the armed periodic tasks, of each task's cost (TinyTask::cost(), in microseconds) divided by its
+ * period. It is kept in parts per million, so TINYSCHEDULER_FULL is 100%.
+ *
+ * With admission checks on, callEvery(), callEveryHz(), callEveryAligned() and setInterval() ask
+ * the scheduler first whether the new period would take the utilisation over the chosen bound:
+ *   TINYSCHEDULER_RM   n(2^(1/n) - 1) for n tasks, from 100% for one task down to 69.3%. Below it,
+ *                      fixed-priority tasks with the shortest period first always meet their deadlines.
+ *   TINYSCHEDULER_EDF  100%, for tasks that are always run earliest deadline first, which is what the
+ *                      scheduler does when they are all due.
+ * A task over the bound is reported to the handler. If reject is true, the call that armed it also
+ * returns false and the task is left as it was. A listed task armed before it was attached (see
+ * begin()) is checked when it is attached, against the tasks attached before it, and disarmed if
+ * it is rejected.
+ *
+ * Tasks with no cost count for nothing, so give each task a cost with setCost(), or measure it with
+ * timeCalls(), before arming it.
+ */
+template <TinySlot N, class Queue, class Clock>
+void TinyScheduler<N, Queue, Clock>::setAdmission(uint8_t bound, boolean reject, TinyAdmissionHandler handler) {
+  TinyScheduler::admission = bound;
+  TinyScheduler::rejectOverBound = reject;
+  TinyScheduler::admissionHandler = handler;
+  TinyScheduler::bind();
+}
+
+template <TinySlot N, class Queue, class Clock>
+unsigned long TinyScheduler<N, Queue, Clock>::load(TinyTask* task, long period) {
+  if (period <= 0 || Clock::HZ == 0) return 0;
+  return (unsigned long)((uint64_t)task->cost() * Clock::HZ / (unsigned long)period);
+}
+
+template <TinySlot N, class Queue, class Clock>
+unsigned long TinyScheduler<N, Queue, Clock>::utilisation() {
+  TinyScheduler::bind();
+  unsigned long total = 0;
+  for (TinySlot i = 0; i < TinyScheduler::count; i++) {
+    TinyTask* task = TinyScheduler::tasks[i];
+    if (task->periodic && (task->armed || task->held)) total += TinyScheduler::load(task, task->interval);
+  }
+  return total;
+}
+
+template <TinySlot N, class Queue, class Clock>
+boolean TinyScheduler<N, Queue, Clock>::admit(TinySlot slot, long period) {
+  if (TinyScheduler::admission == TINYSCHEDULER_ADMIT_ALL) return true;
+  static const uint32_t rateMonotonic[] = {   // n(2^(1/n) - 1) in parts per million, rounded down
+    1000000UL, 828427UL, 779763UL, 756828UL, 743491UL, 734772UL, 728626UL, 724061UL, 720537UL, 717734UL
+  };
+  TinySlot periodic = 1;                      // the task asking, plus the others below
+  unsigned long total = TinyScheduler::load(TinyScheduler::tasks[slot], period);
+  for (TinySlot i = 0; i < TinyScheduler::bound; i++) {   // tasks not yet attached haven't been checked
+    TinyTask* task = TinyScheduler::tasks[i];
+    if (i == slot || !task->periodic || !(task->armed || task->held)) continue;
+    total += TinyScheduler::load(task, task->interval);
+    periodic++;
+  }
+  unsigned long bound = TINYSCHEDULER_FULL;
+  if (TinyScheduler::admission == TINYSCHEDULER_RM) {
+    bound = periodic <= 10 ? rateMonotonic[periodic - 1] : 693147UL;   // ln 2, the limit as n grows
+  }
+  if (total <= bound) return true;
+  if (TinyScheduler::admissionHandler != NULL) TinyScheduler::admissionHandler(*TinyScheduler::tasks[slot], total);
+  return !TinyScheduler::rejectOverBound;
+}
+
+template <TinySlot N, class Queue, class Clock>
+boolean TinyScheduler<N, Queue, Clock>::overloaded() {
+  return TinyScheduler::shedding;
+}
+
+template <TinySlot N, class Queue, class Clock>
+long TinyScheduler<N, Queue, Clock>::lateness() {
+  return TinyScheduler::lateAverage / 16;
+}
+
+#endif
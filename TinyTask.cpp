@@ -34,7 +34,9 @@ void loop() {
  * - Use callAt(), callIni() or callEveryi() to specify when the function should be called:
  *   callIn() calls a function x millseconds or microseconds from now
  *   callAt() calls a function at the time provided (must be within 31 bits of the current time
+ *   callWithin() calls a function once, at any convenient time between two delays from now
  *   callEvery() repeatedly calls a function at the supplied interval
+ *   callEveryHz() repeatedly calls a function at a rate in Hz, which may be a fraction
  * - Put loop into the Arduino loop() method to check and call the function when it is time
  *   loop checks to see if it is time to run the function, and then runs it.
  *   
@@ -104,11 +106,12 @@ THE SOFTWARE.
 // because of how timeout is determined (see above), 
 // if the negative value is very large, and enough time passes between it is set and loop() is
 // called, it may roll over and become a very large delay. To prevent this, we simply reject
-// negative values.
+// negative values. Values over 2^31 - 1 are rejected too: they fit a long where long is 64 bits,
+// but not the 31 bits above, which every TinyScheduler storage option relies on.
 
 // callAt requires a future expiration time as a parameter. This must be no more than 31 bits
-// away from the current time (the result of future expiration minus current time, cast to a long, 
-// must be positive). This is required to adhere to how timeouts are calculated, described above.
+// away from the current time (the result of future expiration minus current time must be at most
+// 2^31 - 1, on every board). This is required to adhere to how timeouts are calculated, described above.
 // The call will fail if a longer timeout is submitted.
 
 // Tasks to be called must return void. As for parameters, the simplest thing is for the task to
@@ -117,90 +120,369 @@ THE SOFTWARE.
 // be created with the number of arguments appended to the TinyTask constructor. More parameters
 // are not supported because of the additional code required.
 
-TinyTask::TinyTask(TaskToCall taskToCall) : 
-  taskToCall(taskToCall) {
-    TinyTask::taskToCallTakesPtr = NULL;
-}
-
-TinyTask::TinyTask(TaskToCallTakesPtr taskToCallTakesPtr) : 
-  taskToCallTakesPtr(taskToCallTakesPtr) {
-    TinyTask::taskToCall = NULL;
-}
+// The constructors are in TinyTask.h: they are constexpr so global TinyTasks need no startup code.
 
 boolean TinyTask::callIn(long interval, void* pointerParam) {
   TinyTask::pointerParam = pointerParam;
-  callIn(interval);
+  return callIn(interval);
 }
 
 boolean TinyTask::callIn(long interval) {
-  if (TinyTask::interval < 0) return false;    // eliminates race condition: a very large negative number which may delay a long time or run immediately
-  if (TinyTask::microseconds) {
-    TinyTask::timeout = micros() + interval;   // calculate the time in the future this will run
-  } else {
-    TinyTask::timeout = millis() + interval;
-  }
+  if (interval < 0 || interval > 0x7FFFFFFFL) return false;    // eliminates race condition: a very large negative number which may delay a long time or run immediately
+  TinyTask::timeout = TinyTask::currentTime() + interval;   // calculate the time in the future this will run
+  TinyTask::resetArming();
   TinyTask::periodic = false;
+  TinyTask::held = false;
   TinyTask::armed = true;
+  TinyTask::notifyScheduler();
   return true;
 }
 
 boolean TinyTask::callAt(unsigned long futureTime, void* pointerParam) {
   TinyTask::pointerParam = pointerParam;
-  callAt(futureTime);
+  return callAt(futureTime);
 }
 
 boolean TinyTask::callAt(unsigned long futureTime) {
-  if (TinyTask::microseconds) {
-    if (futureTime - micros() < 0) {    // if too far into the future/in the past, reject the request
-      return false;
-    }
-  } else {
-    if (futureTime - millis() < 0) {    // if too far into the future/in the past, reject the request
-      return false;
-    }
+  if (futureTime - TinyTask::currentTime() > 0x7FFFFFFFUL) {   // if too far into the future/in the past, reject the request
+    return false;
   }
   TinyTask::timeout = futureTime;
+  TinyTask::resetArming();
+  TinyTask::periodic = false;
+  TinyTask::held = false;
+  TinyTask::armed = true;
+  TinyTask::notifyScheduler();
+  return true;
+}
+
+boolean TinyTask::callWithin(long earliest, long latest, void* pointerParam) {
+  TinyTask::pointerParam = pointerParam;
+  return callWithin(earliest, latest);
+}
+
+/*
+ * The task is armed for latest, and slack records how much earlier it may run. On its own a
+ * TinyTask therefore runs at latest; a TinyScheduler also runs it early, once earliest has
+ * passed, on a pass where it is running other tasks anyway. A task without TinyTaskExtras has
+ * nowhere to keep slack, so it always runs at latest.
+ */
+boolean TinyTask::callWithin(long earliest, long latest) {
+  if (earliest < 0 || latest < earliest || latest > 0x7FFFFFFFL) return false;
+  TinyTask::timeout = TinyTask::currentTime() + latest;
+  TinyTask::resetArming();
+  if (TinyTask::extras != NULL) TinyTask::extras->slack = latest - earliest;
   TinyTask::periodic = false;
+  TinyTask::held = false;
   TinyTask::armed = true;
+  TinyTask::notifyScheduler();
   return true;
 }
 
 boolean TinyTask::callEvery(long interval, void* pointerParam) {
   TinyTask::pointerParam = pointerParam;
-  callEvery(interval);
+  return callEvery(interval);
 }
 
 boolean TinyTask::callEvery(long interval) {
-  if (interval < 0) return false;   // do not permit intervals more than 
+  if (interval < 0 || interval > 0x7FFFFFFFL) return false;   // do not permit intervals more than 31 bits
+  if (!TinyTask::admitted(interval)) return false;
   TinyTask::interval = interval;
-  if (TinyTask::microseconds) { 
-    TinyTask::timeout = micros() + interval;
-  } else {
-    TinyTask::timeout = millis() + interval;
+  TinyTask::timeout = TinyTask::currentTime() + interval;
+  TinyTask::resetArming();
+  TinyTask::applyJitter();
+  TinyTask::periodic = true;
+  TinyTask::held = false;
+  TinyTask::armed = true;
+  TinyTask::notifyScheduler();
+  return true;
+}
+
+boolean TinyTask::callEveryAligned(long period, unsigned long offset, void* pointerParam) {
+  TinyTask::pointerParam = pointerParam;
+  return callEveryAligned(period, offset);
+}
+
+/*
+ * The first deadline is the next time, from now on, that is offset ticks past a multiple of
+ * period on the clock; after that the task runs every period, like callEvery(). Tasks (or boards
+ * whose clocks agree) with the same period and offset therefore run together however far apart
+ * they were started. On the boundary itself the task runs straight away.
+ *
+ * Alignment is to the clock the task reads, so it holds until the clock rolls over (49.7 days of
+ * millis()), unless period divides 2^32.
+ */
+boolean TinyTask::callEveryAligned(long period, unsigned long offset) {
+  if (period <= 0 || period > 0x7FFFFFFFL) return false;
+  if (!TinyTask::admitted(period)) return false;
+  unsigned long now = TinyTask::currentTime();
+  unsigned long past = (now % period + period - offset % period) % period;   // ticks since the last aligned time
+  TinyTask::interval = period;
+  TinyTask::timeout = past == 0 ? now : now + (period - past);
+  TinyTask::resetArming();
+  TinyTask::degrade |= TinyTask::ALIGNED;
+  TinyTask::applyJitter();
+  TinyTask::periodic = true;
+  TinyTask::held = false;
+  TinyTask::armed = true;
+  TinyTask::notifyScheduler();
+  return true;
+}
+
+boolean TinyTask::callEveryHz(unsigned long numerator, unsigned long denominator, void* pointerParam) {
+  TinyTask::pointerParam = pointerParam;
+  return callEveryHz(numerator, denominator);
+}
+
+/*
+ * A rate of numerator/denominator per second is a period of ticksPerSecond * denominator /
+ * numerator ticks, which is rarely a whole number. The whole part goes in interval and the
+ * remainder, in 1/numerator ticks, in fraction. Each period adds fraction to phase, and when phase
+ * reaches a whole tick that period is one tick longer. Over numerator periods the extra ticks add
+ * up to the remainder exactly, so the average rate is exact and never drifts.
+ *
+ * The period must be at least one tick and at most 2^31 - 1 ticks, and the clock's resolution
+ * must be known; otherwise this returns false. So does a period with a fraction of a tick, on a
+ * task without TinyTaskExtras to carry it.
+ */
+boolean TinyTask::callEveryHz(unsigned long numerator, unsigned long denominator) {
+  unsigned long hz = TinyTask::ticksPerSecond();
+  if (numerator == 0 || denominator == 0 || hz == 0) return false;
+  uint64_t ticks = (uint64_t)hz * denominator;   // the period is ticks / numerator
+  uint64_t whole = ticks / numerator;
+  uint32_t fraction = (uint32_t)(ticks % numerator);
+  if (whole == 0 || whole > 0x7FFFFFFFUL || (fraction != 0 && TinyTask::extras == NULL)) return false;
+  if (!TinyTask::admitted((long)whole)) return false;
+  TinyTask::interval = (long)whole;
+  TinyTask::resetArming();
+  if (fraction != 0) {
+    TinyTask::extras->fraction = fraction;
+    TinyTask::extras->fractionBase = (uint32_t)numerator;
+    TinyTask::extras->phase = 0;
   }
+  TinyTask::timeout = TinyTask::currentTime();
+  TinyTask::nextPeriod();
+  TinyTask::applyJitter();
   TinyTask::periodic = true;
+  TinyTask::held = false;
   TinyTask::armed = true;
+  TinyTask::notifyScheduler();
   return true;
 }
 
-void TinyTask::loop() {
-  if (TinyTask::remaining() <= 0) {
-    if (TinyTask::periodic) {
-      while (TinyTask::remaining() <= 0) {
-        TinyTask::timeout = TinyTask::timeout + TinyTask::interval;
-      }
+/*
+ * Jitter moves each run of a periodic task by a random amount, up to jitter ticks either way, from
+ * its nominal deadline. The nominal deadlines stay exactly one period apart, so jitter doesn't
+ * build up and the average period is unchanged. Boards that would otherwise run in lockstep drift
+ * apart, as long as each seeds the generator differently with seedJitter().
+ *
+ * The generator is a 32-bit xorshift shared by every task.
+ */
+uint32_t TinyTask::jitterState = 2463534242UL;
+
+void TinyTask::seedJitter(uint32_t seed) {
+  TinyTask::jitterState = seed == 0 ? 2463534242UL : seed;   // xorshift never leaves 0
+}
+
+// Returns false, for a task without TinyTaskExtras.
+boolean TinyTask::setJitter(unsigned long jitter) {
+  if (TinyTask::extras == NULL) return false;
+  TinyTask::extras->jitter = jitter > 0x3FFFFFFFUL ? 0x3FFFFFFFUL : jitter;
+  return true;
+}
+
+/*
+ * Jitter is held under half the period, so a run moved late and the next one moved early are
+ * still at least a tick apart, and a late run is never counted as a missed period.
+ */
+void TinyTask::applyJitter() {
+  if (TinyTask::extras == NULL) return;
+  unsigned long jitter = TinyTask::extras->jitter;
+  unsigned long most = TinyTask::interval > 0 ? ((unsigned long)TinyTask::interval - 1) / 2 : 0;
+  if (jitter > most) jitter = most;
+  if (jitter == 0) {
+    TinyTask::extras->jittered = 0;
+    return;
+  }
+  uint32_t x = TinyTask::jitterState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  TinyTask::jitterState = x;
+  TinyTask::extras->jittered = (long)(x % (2 * jitter + 1)) - (long)jitter;
+  TinyTask::timeout += TinyTask::extras->jittered;
+}
+
+// The jitter setting and the declared cost outlast re-arming; the rest belongs to one arming.
+void TinyTask::resetArming() {
+  TinyTask::degrade &= TinyTask::DEGRADE;   // the new period is the caller's, so recovery leaves it alone
+  if (TinyTask::extras == NULL) return;
+  TinyTask::extras->fractionBase = 0;
+  TinyTask::extras->jittered = 0;
+  TinyTask::extras->slack = 0;
+}
+
+void TinyTask::nextPeriod() {
+  TinyTask::timeout += TinyTask::interval;
+  TinyTaskExtras* extras = TinyTask::extras;
+  if (extras == NULL || extras->fractionBase == 0) return;
+  if (extras->phase >= extras->fractionBase - extras->fraction) {   // phase + fraction would reach a tick
+    extras->phase -= extras->fractionBase - extras->fraction;
+    TinyTask::timeout++;
+  } else {
+    extras->phase += extras->fraction;
+  }
+}
+
+void TinyTask::skipPeriods(unsigned long periods) {
+  TinyTask::timeout += periods * (unsigned long)TinyTask::interval;
+  TinyTaskExtras* extras = TinyTask::extras;
+  if (extras == NULL || extras->fractionBase == 0) return;
+  uint64_t carried = (uint64_t)extras->phase + (uint64_t)periods * extras->fraction;
+  TinyTask::timeout += (unsigned long)(carried / extras->fractionBase);
+  extras->phase = (uint32_t)(carried % extras->fractionBase);
+}
+
+/*
+ * A periodic task that fell behind skips the periods it missed in one step, worked out by
+ * division, rather than one period at a time, so a task that is far behind costs no more to
+ * catch up than one that is on time. With a fraction of a tick in the period the division can
+ * come up one short, which the loop at the end makes up.
+ */
+unsigned long TinyTask::advance(unsigned long now) {
+  if (!TinyTask::periodic) {
+    TinyTask::armed = false;
+    return 0;
+  }
+  if (TinyTask::interval == 0) {            // callEvery(0): run on every loop
+    TinyTask::timeout = now;
+    return 0;
+  }
+  TinyTaskExtras* extras = TinyTask::extras;
+  if (extras != NULL) TinyTask::timeout -= extras->jittered;   // back to the nominal deadline
+  unsigned long missed = 0;
+  if ((long)(now - TinyTask::timeout) > 0) {
+    unsigned long behind = now - TinyTask::timeout;
+    if (extras == NULL || extras->fractionBase == 0) {
+      missed = behind / (unsigned long)TinyTask::interval;
     } else {
-      TinyTask::armed = false;
+      uint64_t period = (uint64_t)TinyTask::interval * extras->fractionBase + extras->fraction;
+      missed = (unsigned long)((uint64_t)behind * extras->fractionBase / period);
+      if (missed > 0) missed--;
     }
-    TinyTask::callTask();
+    TinyTask::skipPeriods(missed);
+  }
+  TinyTask::nextPeriod();
+  while ((long)(TinyTask::timeout - now) <= 0) {
+    TinyTask::nextPeriod();
+    missed++;
   }
+  TinyTask::applyJitter();
+  return missed;
 }
 
-void TinyTask::callTask() {
-  if (TinyTask::taskToCall != NULL) {
-    TinyTask::taskToCall();
-  } else if (TinyTask::taskToCallTakesPtr != NULL) {
-    TinyTask::taskToCallTakesPtr(TinyTask::pointerParam);
+// Used by a TinyScheduler that is shedding load: the run that is due is dropped.
+void TinyTask::skip(unsigned long now) {
+  TinyTask::advance(now);
+  TinyTask::notifyScheduler();
+}
+
+boolean TinyTask::admitted(long period) {
+  if (TinyTask::scheduler == NULL) return true;
+  return TinyTask::scheduler->admit(TinyTask::slot, period);
+}
+
+// A task the scheduler has already stretched keeps STRETCHED, so recovery still undoes the stretch.
+void TinyTask::setDegradable(uint8_t degrade) {
+  TinyTask::degrade = (TinyTask::degrade & ~TinyTask::DEGRADE) | (degrade & TinyTask::DEGRADE);
+}
+
+void TinyTask::loop() {
+  TinyTask::loop(TinyTask::currentTime());
+}
+
+/*
+ * The time is read once, by the caller, and used for every comparison below, including the
+ * catch-up of a periodic task that missed some of its periods.
+ */
+void TinyTask::loop(unsigned long now) {
+  if (!TinyTask::armed) return;
+  if ((long)(TinyTask::timeout - now) > 0) return;
+  unsigned long started = TinyTask::timed ? micros() : 0;
+  if (TinyTask::calls >= TinyTask::CALLS_FOR_DELAY) {
+    TinyTask::callForDelay();
+    if (TinyTask::timed) TinyTask::recordTime(started);
+    return;
+  }
+  unsigned long scheduled = TinyTask::timeout;
+  unsigned long missed = TinyTask::advance(now);
+  TinyTask::notifyScheduler();              // before the call, so the task may reschedule itself
+  TinyTask::callTask(scheduled, now, missed);
+  if (TinyTask::timed) TinyTask::recordTime(started);
+}
+
+void TinyTask::callTask(unsigned long scheduled, unsigned long now, unsigned long missed) {
+  switch (TinyTask::calls) {
+    case TinyTask::CALLS_VOID:
+      TinyTask::taskToCall();
+      break;
+    case TinyTask::CALLS_POINTER:
+      TinyTask::taskToCallTakesPtr(TinyTask::pointerParam);
+      break;
+    case TinyTask::CALLS_CONTEXT: {
+      TinyTaskContext context = { scheduled, now, (long)(now - scheduled), missed, this, TinyTask::pointerParam };
+      TinyTask::taskTakesContext(context);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/*
+ * The task returns its next delay, which is counted from the time it was due to run, not from
+ * when it actually ran, so a chain of delays doesn't drift. The scheduler hears about the new
+ * deadline once, after the call. Whatever the task does to its own TinyTask during the call is
+ * replaced by what it returns.
+ */
+void TinyTask::callForDelay() {
+  unsigned long due = TinyTask::timeout;
+  long delay;
+  if (TinyTask::calls == TinyTask::CALLS_FOR_DELAY) {
+    delay = TinyTask::taskReturnsDelay();
+  } else {
+    delay = TinyTask::taskReturnsDelayTakesPtr(TinyTask::pointerParam);
+  }
+  if (delay < 0) {                            // TINYTASK_STOP
+    TinyTask::armed = false;
+  } else {
+    if (delay > 0x7FFFFFFFL) delay = 0x7FFFFFFFL;
+    TinyTask::timeout = due + delay;
+    TinyTask::resetArming();
+    TinyTask::held = false;
+    TinyTask::armed = true;
+  }
+  TinyTask::notifyScheduler();
+}
+
+unsigned long TinyTask::currentTime() {
+  if (TinyTask::scheduler != NULL) return TinyTask::scheduler->now();
+  if (TinyTask::microseconds) return TinyMicrosClock::now();
+  return TinyMillisClock::now();
+}
+
+unsigned long TinyTask::ticksPerSecond() {
+  if (TinyTask::scheduler != NULL) return TinyTask::scheduler->ticksPerSecond();
+  if (TinyTask::microseconds) return TinyMicrosClock::HZ;
+  return TinyMillisClock::HZ;
+}
+
+void TinyTask::notifyScheduler() {
+  if (TinyTask::scheduler == NULL) return;
+  if (TinyTask::armed) {
+    TinyTask::scheduler->schedule(TinyTask::slot, TinyTask::timeout);
+  } else {
+    TinyTask::scheduler->unschedule(TinyTask::slot);
   }
 }
 
@@ -217,22 +499,157 @@ void TinyTask::useMicros() {
  * If you have multiple TinyTasks, check all to find the shortest time to sleep.
  */
 long TinyTask::remaining() {
+  return TinyTask::remaining(TinyTask::currentTime());
+}
+
+long TinyTask::remaining(unsigned long now) {
   if (!TinyTask::armed) return -1L;
-  else {
-    unsigned long timeLeft;
-    if (TinyTask::microseconds) {
-      timeLeft = TinyTask::timeout - micros();      
-    } else {
-      timeLeft = TinyTask::timeout - millis();
-    }
-    if (timeLeft < 0) {
-      return 0;
-    } else {
-      return timeLeft;
-    }
+  long timeLeft = (long)(TinyTask::timeout - now);
+  if (timeLeft < 0) {
+    return 0;
+  } else {
+    return timeLeft;
   }
 }
 
 void TinyTask::cancel() {
+  TinyTask::held = false;
   TinyTask::armed = false;
+  TinyTask::notifyScheduler();
+}
+
+/*
+ * While a task is paused, timeout holds the time that was left until it was due, rather than the
+ * deadline, so resume() puts the task back exactly that far ahead of the time it is resumed. Tasks
+ * paused and resumed together keep their phases relative to each other. A task that was already
+ * overdue when paused is overdue by the same amount when resumed.
+ */
+void TinyTask::pause() {
+  TinyTask::pause(TinyTask::currentTime());
+}
+
+void TinyTask::pause(unsigned long now) {
+  if (!TinyTask::armed) return;
+  TinyTask::timeout = TinyTask::timeout - now;
+  TinyTask::armed = false;
+  TinyTask::held = true;
+  TinyTask::notifyScheduler();
+}
+
+void TinyTask::resume() {
+  TinyTask::resume(TinyTask::currentTime());
+}
+
+void TinyTask::resume(unsigned long now) {
+  if (!TinyTask::held) return;
+  TinyTask::timeout = now + TinyTask::timeout;
+  TinyTask::held = false;
+  TinyTask::armed = true;
+  TinyTask::notifyScheduler();
+}
+
+boolean TinyTask::paused() {
+  return TinyTask::held;
+}
+
+/*
+ * The period, including any fraction of a tick from callEveryHz(), and the time left until the
+ * task is due (or, while paused, the time it had left) are multiplied by numerator/denominator,
+ * so scale(2, 1) makes the task run half as often from now on. Returns false, changing nothing,
+ * if the new period would be 0 or longer than 2^31 - 1 ticks.
+ */
+boolean TinyTask::scale(unsigned long numerator, unsigned long denominator) {
+  return TinyTask::scale(numerator, denominator, TinyTask::currentTime());
+}
+
+boolean TinyTask::scale(unsigned long numerator, unsigned long denominator, unsigned long now) {
+  if (denominator == 0) return false;
+  if (TinyTask::periodic && TinyTask::interval != 0) {
+    TinyTaskExtras* extras = TinyTask::extras;
+    uint64_t base = extras == NULL || extras->fractionBase == 0 ? 1 : extras->fractionBase;
+    uint64_t period = (uint64_t)TinyTask::interval * base + (base == 1 ? 0 : extras->fraction);   // in 1/base ticks
+    if (numerator != 0 && period / denominator > 0xFFFFFFFFFFFFFFFFULL / numerator) return false;
+    period = period / denominator * numerator + period % denominator * numerator / denominator;
+    uint64_t whole = period / base;
+    if (whole == 0 || whole > 0x7FFFFFFFUL) return false;
+    TinyTask::interval = (long)whole;
+    if (base != 1) TinyTask::extras->fraction = (uint32_t)(period % base);
+  }
+  TinyTask::scaleTimeLeft(numerator, denominator, now);
+  return true;
+}
+
+void TinyTask::scaleTimeLeft(unsigned long numerator, unsigned long denominator, unsigned long now) {
+  if (!TinyTask::armed && !TinyTask::held) return;
+  long left = TinyTask::held ? (long)TinyTask::timeout : (long)(TinyTask::timeout - now);
+  if (left > 0) {
+    uint64_t scaled = (uint64_t)left * numerator / denominator;
+    left = scaled > 0x7FFFFFFFUL ? 0x7FFFFFFFL : (long)scaled;
+  }
+  if (TinyTask::held) {
+    TinyTask::timeout = (unsigned long)left;
+  } else {
+    TinyTask::timeout = now + left;
+    TinyTask::notifyScheduler();
+  }
+}
+
+/*
+ * Unlike calling callEvery() again, which starts the new period from now, setInterval() keeps the
+ * task's phase:
+ *   TINYTASK_FROM_NEXT  the task still runs at its current deadline, and the new period applies
+ *                       from there on. The deadline doesn't move, so the scheduler isn't told.
+ *   TINYTASK_RESCALE    the time left until the current deadline is scaled by new period / old
+ *                       period, as if the task had always had the new period.
+ * Returns false if the task isn't periodic or the period is negative or over 2^31 - 1 ticks.
+ */
+boolean TinyTask::setInterval(long period, uint8_t mode) {
+  if (!TinyTask::periodic || period < 0 || period > 0x7FFFFFFFL) return false;
+  if (!TinyTask::admitted(period)) return false;
+  if (mode == TINYTASK_RESCALE && TinyTask::interval > 0 && period != TinyTask::interval) {
+    TinyTask::scaleTimeLeft((unsigned long)period, (unsigned long)TinyTask::interval, TinyTask::currentTime());
+  }
+  TinyTask::interval = period;
+  TinyTask::degrade &= ~TinyTask::STRETCHED;
+  if (TinyTask::extras != NULL) TinyTask::extras->fractionBase = 0;
+  return true;
+}
+
+/*
+ * Timing a task costs two reads of micros() each time it runs, so it is off until asked for. The
+ * times are kept in TinyTaskExtras, so a task without them can't be timed, and this returns false.
+ */
+boolean TinyTask::timeCalls(boolean on) {
+  if (TinyTask::extras == NULL) return false;
+  TinyTask::timed = on;
+  return true;
+}
+
+unsigned long TinyTask::cpuTime() {
+  return TinyTask::extras == NULL ? 0 : TinyTask::extras->busy;
+}
+
+void TinyTask::resetCpuTime() {
+  if (TinyTask::extras != NULL) TinyTask::extras->busy = 0;
+}
+
+void TinyTask::recordTime(unsigned long started) {
+  unsigned long elapsed = micros() - started;
+  TinyTask::extras->busy += elapsed;
+  if (elapsed > TinyTask::extras->worst) TinyTask::extras->worst = elapsed;
+}
+
+/*
+ * The cost is used by TinyScheduler::spreadPhases() to even out the load, and by its admission
+ * control. While the task is timed, any call that takes longer than the cost raises it. A task
+ * without TinyTaskExtras has no cost (0, unknown), and setCost() returns false.
+ */
+boolean TinyTask::setCost(unsigned long cost) {
+  if (TinyTask::extras == NULL) return false;
+  TinyTask::extras->worst = cost;
+  return true;
+}
+
+unsigned long TinyTask::cost() {
+  return TinyTask::extras == NULL ? 0 : TinyTask::extras->worst;
 }
@@ -2,40 +2,199 @@
 #define TinyTask_h
 
 #include "Arduino.h"
+#include "TinyClock.h"
 
 typedef void (*TaskToCall)(void);             // defines a callback function datatype
 typedef void (*TaskToCallTakesPtr)(void*);    // defines a callback function that takes a pointer
+typedef long (*TaskReturnsDelay)(void);       // a callback that returns how long until it runs again
+typedef long (*TaskReturnsDelayTakesPtr)(void*);   // same, taking a pointer
+
+#define TINYTASK_STOP -1L                     // returned by a TaskReturnsDelay to stop running
+#define TINYTASK_FROM_NEXT 0                  // setInterval(): the new period starts at the next deadline
+#define TINYTASK_RESCALE 1                    // setInterval(): the time left is scaled to the new period
+#define TINYTASK_KEEP 0                       // setDegradable(): run normally when the scheduler is overloaded
+#define TINYTASK_STRETCH 1                    // setDegradable(): run half as often while overloaded
+#define TINYTASK_DROP 2                       // setDegradable(): skip the runs that fall due while overloaded
+
+class TinyTask;
+
+// What a TaskTakesContext is told about the run it was called for.
+struct TinyTaskContext {
+  unsigned long scheduled;                    // the time the task was due
+  unsigned long now;                          // the time it was called
+  long lateness;                              // now - scheduled
+  unsigned long missed;                       // for a periodic task, the periods skipped to catch up
+  TinyTask* task;                             // the task itself, to cancel or reschedule it
+  void* pointerParam;                         // the pointer given to callIn(), callAt() or callEvery()
+};
+
+typedef void (*TaskTakesContext)(const TinyTaskContext&);   // a callback that is told how late it is
+
+#ifndef TINYTASK_SLOT_T
+#if defined(__AVR__)
+#define TINYTASK_SLOT_T uint8_t               // AVR boards run out of RAM long before 255 tasks
+#else
+#define TINYTASK_SLOT_T uint16_t
+#endif
+#endif
+typedef TINYTASK_SLOT_T TinySlot;             // position of a task in a TinyScheduler's task table
+
+template <uint8_t N> class TinyTimerPool;
+template <TinySlot N, class Queue, class Clock> class TinyScheduler;
+template <TinySlot N> class TinyTaskGroup;
+
+// A TinyTask that belongs to a TinyScheduler tells it whenever its deadline changes, and reads the
+// time from it, so that every task in a scheduler shares one time base.
+class TinySchedulerBase {
+
+  public:
+
+    virtual unsigned long now() = 0;          // the scheduler's current time
+    virtual unsigned long ticksPerSecond() = 0;   // the resolution of now(), or 0 if unknown
+    virtual void schedule(TinySlot slot, unsigned long deadline) = 0;  // task in slot was armed or moved
+    virtual void unschedule(TinySlot slot) = 0;   // task in slot is no longer armed
+    virtual boolean admit(TinySlot slot, long period) = 0;   // may task in slot run every period ticks?
+
+};
+
+// The state of the features most tasks don't use: callEveryHz() fractions, timing and cost,
+// jitter and callWithin() windows. It lives outside TinyTask so that plain tasks don't carry it;
+// a task gets one by being a TinyTaskPlus, or by being given one in its constructor.
+struct TinyTaskExtras {
+  uint32_t fraction;                          // for callEveryHz(), the part of a tick added to interval each period...
+  uint32_t fractionBase;                      // ...in units of 1/fractionBase tick (0 for a whole number of ticks)
+  uint32_t phase;                             // the fractions of a tick carried over so far
+  unsigned long busy;                         // microseconds spent in the task while timed
+  unsigned long worst;                        // the longest call in microseconds, declared or measured
+  unsigned long jitter;                       // the most a periodic run may move from its nominal deadline
+  long jittered;                              // how far timeout was moved from the nominal deadline
+  unsigned long slack;                        // for callWithin(), how long before timeout the task may run
+};
 
 class TinyTask {
 
   private:
   
+    enum Calls : uint8_t { CALLS_NOTHING, CALLS_VOID, CALLS_POINTER, CALLS_CONTEXT, CALLS_FOR_DELAY, CALLS_FOR_DELAY_POINTER };
     bool periodic;                            // signals that callEvery() established a recurring task
     bool armed;                               // signals that the task is currently pending
-    bool microseconds = false;                // indicates whether or not micros() instead of millis() is used
+    bool held;                                // signals that pause() stopped the task; timeout holds the time that was left
+    bool microseconds;                        // indicates whether or not micros() instead of millis() is used
+    bool timed;                               // signals that calls to the task are timed with micros()
+    uint8_t degrade;                          // what an overloaded scheduler may do to the task (TINYTASK_KEEP...), and the flags below
+    Calls calls;                              // which of the functions below this task calls
     void* pointerParam;                       // the pointer parameter to supply to the callback
     long interval;                            // for tasks started with callEvery(), the interval between calls
     unsigned long timeout;                    // the next time a task should be called
-    TaskToCall taskToCall = NULL;             // the function that will be called
-    TaskToCallTakesPtr taskToCallTakesPtr = NULL;  // the function with pointer parameter that will be called
-    void callTask();                          // calls task, with arguments if provided
+    TinyTaskExtras* extras;                   // the state of the optional features, or NULL if the task has none
+    static uint32_t jitterState;              // the xorshift random number generator behind jitter
+    static const uint8_t STRETCHED = 0x80;    // in degrade: an overloaded scheduler doubled the period, and will halve it again
+    static const uint8_t ALIGNED = 0x40;      // in degrade: armed by callEveryAligned(), so spreadPhases() keeps its phase
+    static const uint8_t DEGRADE = 0x3F;      // in degrade: the setDegradable() setting itself
+    union {                                   // the function that will be called; only one is ever set
+      TaskToCall taskToCall;
+      TaskToCallTakesPtr taskToCallTakesPtr;
+      TaskTakesContext taskTakesContext;
+      TaskReturnsDelay taskReturnsDelay;
+      TaskReturnsDelayTakesPtr taskReturnsDelayTakesPtr;
+    };
+    TinySchedulerBase* scheduler;             // the scheduler this task belongs to, if any
+    TinySlot slot;                            // this task's position in the scheduler's task table
+    void callTask(unsigned long scheduled, unsigned long now, unsigned long missed);   // calls task, with arguments if provided
+    void callForDelay();                      // calls a TaskReturnsDelay and arms the task for the delay it returns
+    unsigned long currentTime();              // the scheduler's time, or millis() or micros() if none
+    unsigned long ticksPerSecond();           // the resolution of currentTime()
+    void nextPeriod();                        // moves timeout on by one period, carrying the phase
+    void skipPeriods(unsigned long periods);  // moves timeout on by a number of periods at once
+    unsigned long advance(unsigned long now); // moves timeout past now (or disarms); returns the periods missed
+    void skip(unsigned long now);             // drops the run that is due
+    boolean admitted(long period);            // asks the scheduler whether the task may run every period
+    void applyJitter();                       // moves timeout a random amount from the nominal deadline
+    void resetArming();                       // clears what the last arming left in extras, STRETCHED and ALIGNED
+    void scaleTimeLeft(unsigned long numerator, unsigned long denominator, unsigned long now);
+    void recordTime(unsigned long started);   // adds the time since started, from micros(), to busy and worst
+    void notifyScheduler();                   // tells the scheduler about a new deadline, or cancellation
+
+    // a task with no function yet (used by TinyTimerPool)
+    constexpr TinyTask() :
+      periodic(false), armed(false), held(false), microseconds(false), timed(false), degrade(TINYTASK_KEEP), calls(CALLS_NOTHING),
+      pointerParam(NULL), interval(0), timeout(0), extras(NULL), taskToCall(NULL), scheduler(NULL), slot(0) {}
+
+    template <uint8_t N> friend class TinyTimerPool;   // pool assigns functions to its own tasks
+    template <TinySlot N, class Queue, class Clock> friend class TinyScheduler;   // scheduler runs tasks that are due
+    template <TinySlot N> friend class TinyTaskGroup;   // group reads the time once for all its tasks
 
   public:
   
-    TinyTask(TaskToCall taskToCall);          // optionally specify task type
-    TinyTask(TaskToCallTakesPtr taskToCallTakesPtr);   // optionally specify task type
+    // The constructors are constexpr so that a global TinyTask is built by the compiler and placed
+    // in .data; no constructor code runs at startup. extras, if given, holds the state of the
+    // optional features (see TinyTaskExtras); without it they are unavailable.
+    constexpr TinyTask(TaskToCall taskToCall, TinyTaskExtras* extras = NULL) :       // optionally specify task type
+      periodic(false), armed(false), held(false), microseconds(false), timed(false), degrade(TINYTASK_KEEP), calls(CALLS_VOID),
+      pointerParam(NULL), interval(0), timeout(0), extras(extras), taskToCall(taskToCall), scheduler(NULL), slot(0) {}
+    constexpr TinyTask(TaskToCallTakesPtr taskToCallTakesPtr, TinyTaskExtras* extras = NULL) :   // optionally specify task type
+      periodic(false), armed(false), held(false), microseconds(false), timed(false), degrade(TINYTASK_KEEP), calls(CALLS_POINTER),
+      pointerParam(NULL), interval(0), timeout(0), extras(extras), taskToCallTakesPtr(taskToCallTakesPtr), scheduler(NULL), slot(0) {}
+    constexpr TinyTask(TaskTakesContext taskTakesContext, TinyTaskExtras* extras = NULL) :   // the task is told when it was due
+      periodic(false), armed(false), held(false), microseconds(false), timed(false), degrade(TINYTASK_KEEP), calls(CALLS_CONTEXT),
+      pointerParam(NULL), interval(0), timeout(0), extras(extras), taskTakesContext(taskTakesContext), scheduler(NULL), slot(0) {}
+    constexpr TinyTask(TaskReturnsDelay taskReturnsDelay, TinyTaskExtras* extras = NULL) :   // the task decides when it runs next
+      periodic(false), armed(false), held(false), microseconds(false), timed(false), degrade(TINYTASK_KEEP), calls(CALLS_FOR_DELAY),
+      pointerParam(NULL), interval(0), timeout(0), extras(extras), taskReturnsDelay(taskReturnsDelay), scheduler(NULL), slot(0) {}
+    constexpr TinyTask(TaskReturnsDelayTakesPtr taskReturnsDelayTakesPtr, TinyTaskExtras* extras = NULL) :
+      periodic(false), armed(false), held(false), microseconds(false), timed(false), degrade(TINYTASK_KEEP), calls(CALLS_FOR_DELAY_POINTER),
+      pointerParam(NULL), interval(0), timeout(0), extras(extras), taskReturnsDelayTakesPtr(taskReturnsDelayTakesPtr), scheduler(NULL), slot(0) {}
     boolean callIn(long interval, void* pointerParam);  // task to run interval millis or micros, that takes a pointer
     boolean callIn(long interval);            // sets task to run delay millis or micros from now
     boolean callAt(unsigned long futureTime, void* pointerParam);  // task to run interval millis or micros, that takes a pointer
     boolean callAt(unsigned long futureTime); // sets task to run at a specific time in millis or micros
+    boolean callWithin(long earliest, long latest, void* pointerParam);
+    boolean callWithin(long earliest, long latest);   // runs once, some time between earliest and latest from now
     boolean callEvery(long period, void* pointerParam);      // sets task to run every period millis or micros
     boolean callEvery(long period);           // sets task to run every period millis or micros
-    void useMicros();                         // used to select micros() as time base
+    boolean callEveryAligned(long period, unsigned long offset, void* pointerParam);
+    boolean callEveryAligned(long period, unsigned long offset = 0);   // every period, on multiples of period (+ offset) on the clock
+    boolean callEveryHz(unsigned long numerator, unsigned long denominator, void* pointerParam);
+    boolean callEveryHz(unsigned long numerator, unsigned long denominator = 1);   // runs numerator/denominator times a second
+    boolean setInterval(long period, uint8_t mode = TINYTASK_FROM_NEXT);   // changes the period of a periodic task, keeping its phase
+    void useMicros();                         // used to select micros() as time base (ignored in a TinyScheduler)
     void useMillis();                         // used to select millis() as time base (default)
     long remaining();                         // used to see how much time is remaining before next call
+    long remaining(unsigned long now);        // same, given the current time
     void cancel();                            // stops the task from running in the future
+    void pause();                             // stops the task, keeping the time left until it was due
+    void pause(unsigned long now);            // same, given the current time
+    void resume();                            // restarts a paused task with the time it had left
+    void resume(unsigned long now);           // same, given the current time
+    boolean paused();                         // true between pause() and resume()
+    boolean scale(unsigned long numerator, unsigned long denominator);   // multiplies period and time left by numerator/denominator
+    boolean scale(unsigned long numerator, unsigned long denominator, unsigned long now);   // same, given the current time
+    boolean timeCalls(boolean on = true);     // starts (or stops) adding up the time spent in the task
+    unsigned long cpuTime();                  // microseconds spent in the task while timed
+    void resetCpuTime();                      // sets cpuTime() back to 0
+    boolean setCost(unsigned long cost);      // declares how many microseconds one call takes, at most
+    unsigned long cost();                     // the declared cost, or the longest call measured if longer
+    boolean setJitter(unsigned long jitter);  // runs a periodic task up to jitter ticks either side of each deadline
+    static void seedJitter(uint32_t seed);    // seeds jitter's random numbers; use something unique to the board
+    void setDegradable(uint8_t degrade);      // TINYTASK_STRETCH or TINYTASK_DROP: may be slowed when overloaded
     void loop();                              // call in a loop to check if time to run task
+    void loop(unsigned long now);             // same, given the current time (millis() or micros())
     
 };
 
+// A TinyTask with its own TinyTaskExtras, so that every feature is available.
+class TinyTaskPlus : public TinyTask {
+
+  private:
+
+    TinyTaskExtras state;
+
+  public:
+
+    template <typename Function>
+    constexpr TinyTaskPlus(Function function) : TinyTask(function, &state), state() {}
+    TinyTaskPlus(const TinyTaskPlus&) = delete;   // a copy would share the original's state
+
+};
+
 #endif
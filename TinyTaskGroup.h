@@ -0,0 +1,152 @@
+/*
+ * TinyTaskGroup.h - Treats a set of TinyTasks as one subsystem.
+ *
+ * A TinyTaskGroup holds a table of up to N TinyTasks, chosen at compile time, and passes each of
+ * cancel(), pause(), resume() and scale() on to every task in it. The group doesn't change the
+ * tasks themselves, so a task can be in a group and a TinyScheduler, or in several groups.
+ *
+ * EXAMPLE:
+
+#include "TinyScheduler.h"
+#include "TinyTaskGroup.h"
+
+TinyTask readSensor(readSensorTask);
+TinyTask filter(filterTask);
+TinyTask transmit(transmitTask);
+TinyScheduler<4> scheduler(readSensor, filter, transmit);
+TinyTaskGroup<2> sensing(readSensor, filter);   //  <-- Room for 2 tasks
+
+void transmitTask() {
+  sensing.pause();          //  <-- Keep the sensors quiet while the radio is on
+  sendPacket();
+  sensing.resume();         //  <-- Every sensing task picks up where it left off
+}
+
+ * pause(), resume() and scale() read the clock once for the whole group, from the first task, so
+ * the tasks' phases relative to each other are kept. The tasks in a group should therefore share
+ * a time base.
+ *
+ * timeCalls() turns on timing of every task in the group, and cpuTime() then adds up the
+ * microseconds spent in them. Only a TinyTaskPlus (or a task given TinyTaskExtras) can be timed;
+ * timeCalls() returns false if any task in the group can't be, and cpuTime() leaves it out.
+ */
+
+#ifndef TinyTaskGroup_h
+#define TinyTaskGroup_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+
+template <TinySlot N>
+class TinyTaskGroup {
+
+  static_assert(N > 0, "TinyTaskGroup must hold at least one task");
+
+  private:
+
+    TinyTask* tasks[N];                       // the tasks in the group; entries past count are NULL
+    TinySlot count;                           // the number of tasks in the group
+    unsigned long now();                      // the time base of the group's first task
+
+  public:
+
+    constexpr TinyTaskGroup() : tasks{}, count(0) {}   // an empty group; use add() to fill it
+
+    // a group holding the listed tasks, built at compile time
+    template <typename... Tasks>
+    constexpr TinyTaskGroup(TinyTask& first, Tasks&... rest) :
+      tasks{ &first, &rest... }, count(1 + sizeof...(rest)) {
+        static_assert(1 + sizeof...(rest) <= N, "more tasks listed than the TinyTaskGroup can hold");
+    }
+
+    boolean add(TinyTask& task);              // adds a task to the group; false if the group is full
+    TinySlot size();                          // the number of tasks in the group
+    TinySlot capacity();                      // the most tasks the group can hold
+    void cancel();                            // cancels every task
+    void pause();                             // pauses every task, keeping their phases
+    void resume();                            // resumes every paused task
+    boolean scale(unsigned long numerator, unsigned long denominator);   // scales every task; false if any could not be
+    boolean timeCalls(boolean on = true);     // starts (or stops) timing every task; false if any can't be timed
+    unsigned long cpuTime();                  // total microseconds spent in the group's tasks while timed
+    void resetCpuTime();                      // sets every task's cpuTime() back to 0
+
+};
+
+template <TinySlot N>
+unsigned long TinyTaskGroup<N>::now() {
+  return TinyTaskGroup::tasks[0]->currentTime();
+}
+
+template <TinySlot N>
+boolean TinyTaskGroup<N>::add(TinyTask& task) {
+  if (TinyTaskGroup::count >= N) return false;
+  TinyTaskGroup::tasks[TinyTaskGroup::count++] = &task;
+  return true;
+}
+
+template <TinySlot N>
+TinySlot TinyTaskGroup<N>::size() {
+  return TinyTaskGroup::count;
+}
+
+template <TinySlot N>
+TinySlot TinyTaskGroup<N>::capacity() {
+  return N;
+}
+
+template <TinySlot N>
+void TinyTaskGroup<N>::cancel() {
+  for (TinySlot i = 0; i < TinyTaskGroup::count; i++) TinyTaskGroup::tasks[i]->cancel();
+}
+
+template <TinySlot N>
+void TinyTaskGroup<N>::pause() {
+  if (TinyTaskGroup::count == 0) return;
+  unsigned long now = TinyTaskGroup::now();
+  for (TinySlot i = 0; i < TinyTaskGroup::count; i++) TinyTaskGroup::tasks[i]->pause(now);
+}
+
+template <TinySlot N>
+void TinyTaskGroup<N>::resume() {
+  if (TinyTaskGroup::count == 0) return;
+  unsigned long now = TinyTaskGroup::now();
+  for (TinySlot i = 0; i < TinyTaskGroup::count; i++) TinyTaskGroup::tasks[i]->resume(now);
+}
+
+/*
+ * scale(2, 1) halves the rate of every task, scale(1, 2) doubles it. A task whose period would
+ * become 0 or too long is left as it was, and scale() returns false.
+ */
+template <TinySlot N>
+boolean TinyTaskGroup<N>::scale(unsigned long numerator, unsigned long denominator) {
+  if (TinyTaskGroup::count == 0) return true;
+  unsigned long now = TinyTaskGroup::now();
+  boolean scaled = true;
+  for (TinySlot i = 0; i < TinyTaskGroup::count; i++) {
+    if (!TinyTaskGroup::tasks[i]->scale(numerator, denominator, now)) scaled = false;
+  }
+  return scaled;
+}
+
+template <TinySlot N>
+boolean TinyTaskGroup<N>::timeCalls(boolean on) {
+  boolean timed = true;
+  for (TinySlot i = 0; i < TinyTaskGroup::count; i++) {
+    if (!TinyTaskGroup::tasks[i]->timeCalls(on)) timed = false;
+  }
+  return timed;
+}
+
+template <TinySlot N>
+unsigned long TinyTaskGroup<N>::cpuTime() {
+  unsigned long total = 0;
+  for (TinySlot i = 0; i < TinyTaskGroup::count; i++) total += TinyTaskGroup::tasks[i]->cpuTime();
+  return total;
+}
+
+template <TinySlot N>
+void TinyTaskGroup<N>::resetCpuTime() {
+  for (TinySlot i = 0; i < TinyTaskGroup::count; i++) TinyTaskGroup::tasks[i]->resetCpuTime();
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * TinyTimerPool.h - Fire-and-forget one-shot timers for TinyTask.
+ *
+ * A TinyTimerPool holds a fixed number of TinyTasks, chosen at compile time. after() takes a free
+ * one from the pool, points it at your function and arms it. When the timer fires, or is cancelled,
+ * its TinyTask is no longer armed and goes back into the pool by itself. No malloc is used.
+ *
+ * EXAMPLE:
+
+#include "TinyTimerPool.h"
+
+void ledOff() {
+  digitalWrite(13, LOW);
+}
+
+TinyTimerPool<4> timers;    //  <-- Up to 4 timers pending at once
+
+void setup() {
+  pinMode(13, OUTPUT);
+  digitalWrite(13, HIGH);
+  timers.after(500, ledOff);  //  <-- Turn the LED off in 500 ms. No TinyTask needs to be declared.
+}
+
+void loop() {
+  timers.loop();            //  <-- Check all pending timers, run those that are due
+}
+
+ * after() returns a TinyTimer handle. If the pool is full, the handle is not valid() and
+ * exhausted() counts the failure. highWater() reports the most timers ever pending at once,
+ * which tells you how big the pool needs to be.
+ *
+ * A handle remembers which use of the slot it belongs to, so cancel() on a handle for a timer
+ * that already fired does nothing, even if the slot has since been reused. The use is counted in
+ * 8 bits, to keep handles at 2 bytes, so this holds for 255 reuses of the slot: a handle kept
+ * through 256 of them matches the slot again, and would cancel whichever timer is in it then.
+ * Don't keep handles that long; drop them once pending() is false.
+ */
+
+#ifndef TinyTimerPool_h
+#define TinyTimerPool_h
+
+#include "Arduino.h"
+#include "TinyTask.h"
+
+#define TINYTIMER_NONE 0xFF                   // slot number of a handle that refers to no timer
+
+struct TinyTimer {
+  uint8_t slot;                               // which pool slot the timer uses, or TINYTIMER_NONE
+  uint8_t generation;                         // which use of that slot the handle belongs to (wraps after 256)
+  boolean valid() { return slot != TINYTIMER_NONE; }  // false if after() could not get a slot
+};
+
+template <uint8_t N>
+class TinyTimerPool {
+
+  static_assert(N > 0 && N < TINYTIMER_NONE, "TinyTimerPool holds 1 to 254 timers");
+
+  private:
+
+    TinyTask timers[N];                       // the pooled tasks; a task that is neither armed nor paused is free
+    uint8_t generation[N];                    // bumped every time a slot is handed out
+    uint8_t highWaterMark;                    // most timers ever pending at once
+    unsigned int exhaustedCount;              // number of times after() found the pool full
+    TinyTimer acquire();                      // finds a free slot and records the statistics
+
+    template <TinySlot M, class Queue, class Clock> friend class TinyScheduler;   // a scheduler can run the pool's timers
+
+  public:
+
+    constexpr TinyTimerPool() :               // constexpr, so a global pool needs no startup code
+      timers{}, generation{}, highWaterMark(0), exhaustedCount(0) {}
+
+    TinyTimer after(long delay, TaskToCall taskToCall);  // calls task once, delay millis or micros from now
+    TinyTimer after(long delay, TaskToCallTakesPtr taskToCallTakesPtr, void* pointerParam);  // same, with a pointer
+    boolean cancel(TinyTimer timer);          // cancels the timer and frees its slot; false if it already ran
+    boolean pending(TinyTimer timer);         // true if the timer has not run yet
+    void useMicros();                         // used to select micros() as time base for all timers
+    void useMillis();                         // used to select millis() as time base (default)
+    long remaining();                         // time until the next timer is due, or -1 if none pending
+    long remaining(unsigned long now);        // same, given the current time
+    void loop();                              // call in a loop to run the timers that are due
+    void loop(unsigned long now);             // same, given the current time
+    uint8_t capacity();                       // the number of slots in the pool
+    uint8_t inUse();                          // the number of timers currently pending
+    uint8_t highWater();                      // the most timers that were ever pending at once
+    unsigned int exhausted();                 // how many times after() failed because the pool was full
+
+};
+
+template <uint8_t N>
+TinyTimer TinyTimerPool<N>::acquire() {
+  TinyTimer timer = { TINYTIMER_NONE, 0 };
+  uint8_t used = 1;                           // counts the timer being handed out
+  for (uint8_t i = 0; i < N; i++) {
+    if (TinyTimerPool::timers[i].armed || TinyTimerPool::timers[i].held) {
+      used++;
+    } else if (timer.slot == TINYTIMER_NONE) {
+      timer.slot = i;
+    }
+  }
+  if (timer.slot == TINYTIMER_NONE) {
+    if (TinyTimerPool::exhaustedCount != 0xFFFF) TinyTimerPool::exhaustedCount++;
+    return timer;
+  }
+  if (used > TinyTimerPool::highWaterMark) TinyTimerPool::highWaterMark = used;
+  timer.generation = ++TinyTimerPool::generation[timer.slot];
+  return timer;
+}
+
+template <uint8_t N>
+TinyTimer TinyTimerPool<N>::after(long delay, TaskToCall taskToCall) {
+  TinyTimer timer = { TINYTIMER_NONE, 0 };
+  if (delay < 0 || delay > 0x7FFFFFFFL) return timer;   // rejected, same as TinyTask::callIn()
+  timer = TinyTimerPool::acquire();
+  if (timer.valid()) {
+    TinyTask* task = &TinyTimerPool::timers[timer.slot];
+    task->calls = TinyTask::CALLS_VOID;
+    task->taskToCall = taskToCall;
+    task->callIn(delay);
+  }
+  return timer;
+}
+
+template <uint8_t N>
+TinyTimer TinyTimerPool<N>::after(long delay, TaskToCallTakesPtr taskToCallTakesPtr, void* pointerParam) {
+  TinyTimer timer = { TINYTIMER_NONE, 0 };
+  if (delay < 0 || delay > 0x7FFFFFFFL) return timer;
+  timer = TinyTimerPool::acquire();
+  if (timer.valid()) {
+    TinyTask* task = &TinyTimerPool::timers[timer.slot];
+    task->calls = TinyTask::CALLS_POINTER;
+    task->taskToCallTakesPtr = taskToCallTakesPtr;
+    task->callIn(delay, pointerParam);
+  }
+  return timer;
+}
+
+template <uint8_t N>
+boolean TinyTimerPool<N>::pending(TinyTimer timer) {
+  if (timer.slot >= N) return false;
+  if (TinyTimerPool::generation[timer.slot] != timer.generation) return false;   // slot was reused
+  return TinyTimerPool::timers[timer.slot].armed || TinyTimerPool::timers[timer.slot].held;
+}
+
+template <uint8_t N>
+boolean TinyTimerPool<N>::cancel(TinyTimer timer) {
+  if (!TinyTimerPool::pending(timer)) return false;
+  TinyTimerPool::timers[timer.slot].cancel();
+  return true;
+}
+
+template <uint8_t N>
+void TinyTimerPool<N>::useMicros() {
+  for (uint8_t i = 0; i < N; i++) TinyTimerPool::timers[i].useMicros();
+}
+
+template <uint8_t N>
+void TinyTimerPool<N>::useMillis() {
+  for (uint8_t i = 0; i < N; i++) TinyTimerPool::timers[i].useMillis();
+}
+
+template <uint8_t N>
+long TinyTimerPool<N>::remaining() {
+  return TinyTimerPool::remaining(TinyTimerPool::timers[0].currentTime());   // all timers share a time base
+}
+
+template <uint8_t N>
+long TinyTimerPool<N>::remaining(unsigned long now) {
+  long shortest = -1L;
+  for (uint8_t i = 0; i < N; i++) {
+    long timeLeft = TinyTimerPool::timers[i].remaining(now);
+    if (timeLeft >= 0 && (shortest < 0 || timeLeft < shortest)) shortest = timeLeft;
+  }
+  return shortest;
+}
+
+template <uint8_t N>
+void TinyTimerPool<N>::loop() {
+  TinyTimerPool::loop(TinyTimerPool::timers[0].currentTime());
+}
+
+template <uint8_t N>
+void TinyTimerPool<N>::loop(unsigned long now) {
+  for (uint8_t i = 0; i < N; i++) {
+    TinyTimerPool::timers[i].loop(now);
+  }
+}
+
+template <uint8_t N>
+uint8_t TinyTimerPool<N>::capacity() {
+  return N;
+}
+
+template <uint8_t N>
+uint8_t TinyTimerPool<N>::inUse() {
+  uint8_t used = 0;
+  for (uint8_t i = 0; i < N; i++) {
+    if (TinyTimerPool::timers[i].armed || TinyTimerPool::timers[i].held) used++;
+  }
+  return used;
+}
+
+template <uint8_t N>
+uint8_t TinyTimerPool<N>::highWater() {
+  return TinyTimerPool::highWaterMark;
+}
+
+template <uint8_t N>
+unsigned int TinyTimerPool<N>::exhausted() {
+  return TinyTimerPool::exhaustedCount;
+}
+
+#endif
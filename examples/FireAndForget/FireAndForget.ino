@@ -0,0 +1,29 @@
+#include "TinyTimerPool.h"
+
+#define LED 13
+#define BUTTON 2
+
+TinyTimerPool<4> timers;      //  <-- Up to 4 timers may be pending at once
+
+void ledOff() {
+  digitalWrite(LED, LOW);
+}
+
+void setup() {
+  Serial.begin(9600);
+  pinMode(LED, OUTPUT);
+  pinMode(BUTTON, INPUT_PULLUP);
+}
+
+void loop() {
+  static boolean wasPressed = false;
+  boolean pressed = digitalRead(BUTTON) == LOW;
+  if (pressed && !wasPressed) {
+    digitalWrite(LED, HIGH);
+    if (!timers.after(1000, ledOff).valid()) {   //  <-- Turn the LED off one second after each press
+      Serial.println("Out of timers!");
+    }
+  }
+  wasPressed = pressed;
+  timers.loop();              //  <-- Run timers that are due. Their slots go back to the pool.
+}
@@ -0,0 +1,156 @@
+/*
+ * Compares the TinyScheduler deadline stores on a mix of callEvery(), callIn() and cancel().
+ *
+ * The queues are driven directly with a simulated clock, one tick per step, so the results
+ * measure the data structures and not the tasks. Each step re-arms the periodic slots that fell
+ * due (as callEvery() would), and with some probability arms a random slot with callIn(),
+ * re-arms one with a new period, or cancels one. Results are printed to Serial in microseconds.
+ *
+ * It then measures the idle path: a pass of a TinyScheduler with 8 tasks, none of them due,
+ * compared with calling loop() on each of the 8 TinyTasks.
+ *
+ * Change BENCH_TASKS to try other sizes. AVR boards only have room for a few dozen. Above 10000
+ * tasks the linear and delta list stores are left out (each pass is O(n) for them), and above
+ * 65534 TINYTASK_SLOT_T must be defined as uint32_t for the whole build.
+ */
+
+#include "TinyScheduler.h"
+
+#if !defined(BENCH_TASKS)
+#if defined(__AVR__)
+#define BENCH_TASKS 32
+#else
+#define BENCH_TASKS 1000
+#endif
+#endif
+
+#if !defined(BENCH_STEPS)
+#if defined(__AVR__)
+#define BENCH_STEPS 20000UL
+#else
+#define BENCH_STEPS 1000000UL
+#endif
+#endif
+
+#if BENCH_TASKS <= 10000
+TinyLinearQueue<BENCH_TASKS> linearQueue;
+TinyDeltaQueue<BENCH_TASKS> deltaQueue;
+#endif
+TinyHeapQueue<BENCH_TASKS> heapQueue;
+TinyRadixHeap<BENCH_TASKS> radixHeap;
+TinyCalendarQueue<BENCH_TASKS> calendarQueue;
+
+uint32_t deadlines[BENCH_TASKS];              // what each slot was armed for
+uint32_t periods[BENCH_TASKS];                // 0 for one-shot slots
+TinySlot dueSlots[BENCH_TASKS];
+uint32_t seed;
+
+uint32_t nextRandom() {                       // xorshift32
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+template <class Queue>
+void arm(Queue& queue, TinySlot slot, uint32_t deadline, uint32_t period, uint32_t now) {
+  deadlines[slot] = deadline;
+  periods[slot] = period;
+  queue.set(slot, deadline, now);
+}
+
+template <class Queue>
+void benchmark(const char* name, Queue& queue) {
+  seed = 2463534242UL;
+  uint32_t now = 0;
+  unsigned long fired = 0;
+  for (TinySlot slot = 0; slot < BENCH_TASKS; slot++) {     // 3 in 4 periodic, the rest one-shot
+    uint32_t period = 10 + nextRandom() % 5000;
+    arm(queue, slot, now + period, (slot & 3) ? period : 0, now);
+  }
+  unsigned long start = micros();
+  for (unsigned long step = 0; step < BENCH_STEPS; step++) {
+    now++;
+    TinySlot due = queue.due(now, dueSlots);
+    for (TinySlot i = 0; i < due; i++) {
+      TinySlot slot = dueSlots[i];
+      if ((int32_t)(deadlines[slot] - now) > 0) {           // reported early (TinyDeltaQueue)
+        queue.set(slot, deadlines[slot], now);
+        continue;
+      }
+      fired++;
+      if (periods[slot] != 0) arm(queue, slot, deadlines[slot] + periods[slot], periods[slot], now);
+    }
+    uint32_t r = nextRandom();
+    TinySlot slot = (TinySlot)((r >> 8) % BENCH_TASKS);
+    switch (r & 15) {
+      case 0:                                                // callIn()
+        arm(queue, slot, now + 1 + (r >> 16) % 20000, 0, now);
+        break;
+      case 1:                                                // callEvery() with a new period
+        arm(queue, slot, now + 10 + (r >> 16) % 5000, 10 + (r >> 16) % 5000, now);
+        break;
+      case 2:                                                // cancel()
+        queue.clear(slot);
+        break;
+    }
+  }
+  unsigned long elapsed = micros() - start;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(elapsed);
+  Serial.print(" us for ");
+  Serial.print(BENCH_STEPS);
+  Serial.print(" steps, ");
+  Serial.print(fired);
+  Serial.println(" fired");
+}
+
+#define IDLE_PASSES 10000UL
+
+void idleTask() {
+}
+
+TinyTask idleTasks[8] = {
+  TinyTask(idleTask), TinyTask(idleTask), TinyTask(idleTask), TinyTask(idleTask),
+  TinyTask(idleTask), TinyTask(idleTask), TinyTask(idleTask), TinyTask(idleTask)
+};
+TinyScheduler<8> idleScheduler;
+
+void benchmarkIdle() {
+  for (uint8_t i = 0; i < 8; i++) idleTasks[i].callIn(3600000L);   // an hour away: nothing due
+  unsigned long start = micros();
+  for (unsigned long pass = 0; pass < IDLE_PASSES; pass++) {
+    for (uint8_t i = 0; i < 8; i++) idleTasks[i].loop();
+  }
+  unsigned long separate = micros() - start;
+  for (uint8_t i = 0; i < 8; i++) idleScheduler.add(idleTasks[i]);
+  start = micros();
+  for (unsigned long pass = 0; pass < IDLE_PASSES; pass++) {
+    idleScheduler.loop();
+  }
+  unsigned long scheduled = micros() - start;
+  Serial.print("Idle pass, 8 x TinyTask::loop(): ");
+  Serial.print(separate * 1000 / IDLE_PASSES);
+  Serial.println(" ns");
+  Serial.print("Idle pass, TinyScheduler::loop(): ");
+  Serial.print(scheduled * 1000 / IDLE_PASSES);
+  Serial.println(" ns");
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial.print(BENCH_TASKS);
+  Serial.println(" tasks");
+#if BENCH_TASKS <= 10000
+  benchmark("TinyLinearQueue  ", linearQueue);
+  benchmark("TinyDeltaQueue   ", deltaQueue);
+#endif
+  benchmark("TinyHeapQueue    ", heapQueue);
+  benchmark("TinyRadixHeap    ", radixHeap);
+  benchmark("TinyCalendarQueue", calendarQueue);
+  benchmarkIdle();
+}
+
+void loop() {
+}
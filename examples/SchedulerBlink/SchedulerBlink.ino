@@ -0,0 +1,40 @@
+#include "TinyScheduler.h"
+
+#define RED_LED 11
+#define GREEN_LED 12
+#define YELLOW_LED 13
+
+void blinkRedTask() {
+  static boolean state;
+  digitalWrite(RED_LED, state = !state);
+}
+
+void blinkGreenTask() {
+  static boolean state;
+  digitalWrite(GREEN_LED, state = !state);
+}
+
+void blinkYellowTask() {
+  static boolean state;
+  digitalWrite(YELLOW_LED, state = !state);
+}
+
+TinyTask blinkRed(blinkRedTask);
+TinyTask blinkGreen(blinkGreenTask);
+TinyTask blinkYellow(blinkYellowTask);
+
+TinyScheduler<3> scheduler(blinkRed, blinkGreen, blinkYellow);   //  <-- Built at compile time, no startup code
+
+void setup() {
+  pinMode(RED_LED, OUTPUT);
+  pinMode(GREEN_LED, OUTPUT);
+  pinMode(YELLOW_LED, OUTPUT);
+  scheduler.begin();        //  <-- Attaches the listed tasks; call before arming them
+  blinkRed.callEvery(50);
+  blinkGreen.callEvery(250);
+  blinkYellow.callEvery(1000);
+}
+
+void loop() {
+  scheduler.loop();         //  <-- One call checks all three tasks
+}
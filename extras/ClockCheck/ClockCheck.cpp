@@ -0,0 +1,73 @@
+/*
+ * ClockCheck.cpp - Checks that TinyMonotonicClock never goes backwards, on a Linux computer.
+ *
+ * TinyTask compares times as (long)(deadline - now), so a clock that steps back even one tick
+ * makes tasks that were due look as if they are not. For a range of rates, including ones that
+ * don't divide 10^9, this converts CLOCK_MONOTONIC readings across whole seconds and checks each
+ * is at least the one before, then reads the real clock across a second boundary.
+ *
+ * BUILD AND RUN (from the library folder):
+
+g++ -std=gnu++11 -O2 -I extras/TinyAnalyser -I . extras/ClockCheck/ClockCheck.cpp -o clockcheck && ./clockcheck
+
+ * Prints one line per rate and exits with 1 if any check failed.
+ */
+
+#include <stdio.h>
+#include "TinyClock.h"
+
+#define CLOCKCHECK_STEP 9973L                 // nanoseconds between converted readings
+#define CLOCKCHECK_SPAN 1100000000L           // how long the real clock is read, in nanoseconds
+
+// Converted readings from the start of second to the start of the next, and the last tick of it.
+template <unsigned long Hz>
+static bool checkSecond(time_t second) {
+  struct timespec ts = { second, 0 };
+  unsigned long previous = TinyMonotonicClock<Hz>::ticks(ts);
+  for (long nanoseconds = CLOCKCHECK_STEP; nanoseconds < 1000000000L + CLOCKCHECK_STEP; nanoseconds += CLOCKCHECK_STEP) {
+    ts.tv_nsec = nanoseconds < 1000000000L ? nanoseconds : 999999999L;
+    unsigned long now = TinyMonotonicClock<Hz>::ticks(ts);
+    if ((long)(now - previous) < 0) return false;
+    previous = now;
+  }
+  ts.tv_sec = second + 1;
+  ts.tv_nsec = 0;
+  unsigned long next = TinyMonotonicClock<Hz>::ticks(ts);
+  return (long)(next - previous) >= 0 && next - previous <= 1;
+}
+
+template <unsigned long Hz>
+static bool checkReal() {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  unsigned long previous = TinyMonotonicClock<Hz>::now();
+  for (;;) {
+    unsigned long now = TinyMonotonicClock<Hz>::now();
+    if ((long)(now - previous) < 0) return false;
+    previous = now;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if ((ts.tv_sec - start.tv_sec) * 1000000000L + (ts.tv_nsec - start.tv_nsec) > CLOCKCHECK_SPAN) return true;
+  }
+}
+
+template <unsigned long Hz>
+static bool check(bool real) {
+  bool ok = checkSecond<Hz>(0) && checkSecond<Hz>(1) && checkSecond<Hz>(4294) && checkSecond<Hz>(86400);
+  bool realOk = !real || checkReal<Hz>();
+  printf("%10lu Hz  converted: %s, real clock: %s\n", Hz, ok ? "ok" : "FAILED", real ? (realOk ? "ok" : "FAILED") : "not read");
+  return ok && realOk;
+}
+
+int main() {
+  bool ok = true;
+  ok &= check<1UL>(false);
+  ok &= check<3UL>(false);
+  ok &= check<1000UL>(false);
+  ok &= check<32768UL>(false);
+  ok &= check<600000UL>(true);
+  ok &= check<1000000UL>(false);
+  ok &= check<3000000UL>(false);
+  ok &= check<1000000000UL>(false);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/*
+ * QueueCheck.cpp - Checks every TinyScheduler storage option against standalone TinyTasks, on a computer.
+ *
+ * Each check runs the same tasks twice, side by side, in TinyVirtualClock time: once in a
+ * TinyScheduler using the queue under test, and once as standalone TinyTasks, each polled with its
+ * own loop(). Every task must run the same number of times, at the same times, in both. Standalone
+ * TinyTasks need no queue, so they are the reference. The scheduler's remaining() must not be
+ * later than the earliest of its tasks' remaining(), or a board sleeping on it would oversleep.
+ *
+ * The clock jumps ahead to the next deadline when nothing is due, so there are long idle stretches
+ * in which no scheduler pass reaches the queue, and deadlines up to 2^31 ticks away. Delays and
+ * periods of 2^31 ticks or more are tried too; TinyTask must refuse them, on every host.
+ *
+ * BUILD AND RUN (from the library folder):
+
+g++ -std=gnu++11 -O2 -I extras/TinyAnalyser -I . extras/QueueCheck/QueueCheck.cpp TinyTask.cpp -o queuecheck && ./queuecheck
+
+ * Prints one line per queue and exits with 1 if any check failed.
+ */
+
+#include <stdio.h>
+#include "TinyScheduler.h"
+
+#define QUEUECHECK_TASKS 16
+#define QUEUECHECK_SEEDS 160                  // random runs for each queue
+#define QUEUECHECK_STEPS 4000                 // arming calls and clock jumps in each run
+
+unsigned long millis() {
+  return TinyVirtualClock::now() / 1000;
+}
+
+unsigned long micros() {
+  return TinyVirtualClock::now();
+}
+
+struct Record {
+  unsigned long runs;
+  unsigned long times;                        // sum of the times the task ran at
+};
+
+static void ran(void* pointerParam) {
+  Record* record = (Record*)pointerParam;
+  record->runs++;
+  record->times += TinyVirtualClock::now();
+}
+
+static uint32_t seed;
+
+static uint32_t nextRandom() {                // xorshift32
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+// The same tasks in a scheduler and standing alone; every call is made on both.
+template <class Queue>
+struct Pair {
+
+  TinyScheduler<QUEUECHECK_TASKS, Queue, TinyMicrosClock> scheduler;
+  TinyTask* scheduled[QUEUECHECK_TASKS];
+  TinyTask* standalone[QUEUECHECK_TASKS];
+  Record inScheduler[QUEUECHECK_TASKS];
+  Record alone[QUEUECHECK_TASKS];
+
+  Pair() {
+    for (int i = 0; i < QUEUECHECK_TASKS; i++) {
+      scheduled[i] = new TinyTask(ran);
+      standalone[i] = new TinyTask(ran);
+      standalone[i]->useMicros();
+      inScheduler[i] = Record();
+      alone[i] = Record();
+      scheduler.add(*scheduled[i]);
+    }
+  }
+
+  ~Pair() {
+    for (int i = 0; i < QUEUECHECK_TASKS; i++) {
+      delete scheduled[i];
+      delete standalone[i];
+    }
+  }
+
+  void callIn(int i, long delay) {
+    scheduled[i]->callIn(delay, &inScheduler[i]);
+    standalone[i]->callIn(delay, &alone[i]);
+  }
+
+  void callEvery(int i, long period) {
+    scheduled[i]->callEvery(period, &inScheduler[i]);
+    standalone[i]->callEvery(period, &alone[i]);
+  }
+
+  void cancel(int i) {
+    scheduled[i]->cancel();
+    standalone[i]->cancel();
+  }
+
+  // Moves the clock on by up to jump ticks, stopping at the next deadline, and runs what is due.
+  void idle(unsigned long jump) {
+    unsigned long now = TinyVirtualClock::now();
+    for (int i = 0; i < QUEUECHECK_TASKS; i++) {
+      long timeLeft = standalone[i]->remaining(now);
+      if (timeLeft >= 0 && (unsigned long)timeLeft < jump) jump = timeLeft;
+    }
+    TinyVirtualClock::advance(jump);
+    now = TinyVirtualClock::now();
+    scheduler.loop(now);
+    for (int i = 0; i < QUEUECHECK_TASKS; i++) standalone[i]->loop(now);
+  }
+
+  // The first task that ran differently or was armed too far ahead, or -1; QUEUECHECK_TASKS if
+  // the scheduler's remaining() is wrong.
+  int mismatch() {
+    unsigned long now = TinyVirtualClock::now();
+    long earliest = -1;
+    for (int i = 0; i < QUEUECHECK_TASKS; i++) {
+      if (inScheduler[i].runs != alone[i].runs || inScheduler[i].times != alone[i].times) return i;
+      long timeLeft = scheduled[i]->remaining(now);
+      if (timeLeft > 0x7FFFFFFFL) return i;
+      if (timeLeft >= 0 && (earliest < 0 || timeLeft < earliest)) earliest = timeLeft;
+    }
+    long timeLeft = scheduler.remaining(now);
+    if ((timeLeft < 0) != (earliest < 0) || timeLeft > earliest) return QUEUECHECK_TASKS;
+    return -1;
+  }
+
+};
+
+// A delay or period: mostly short, sometimes up to 2^31 ticks, and now and then more than that
+// (which is negative where long is 32 bits; either way TinyTask refuses it).
+static long randomTime() {
+  uint32_t r = nextRandom();
+  switch (r & 7) {
+    case 0:
+    case 1:
+    case 2: return 1 + (r >> 3) % 1000;
+    case 3:
+    case 4: return 1 + (r >> 3) % 0x100000;
+    case 5: return (long)(0x80000000UL + (r >> 3));
+    default: return 1 + (r >> 3) % 0x7FFFF000;
+  }
+}
+
+// Tasks near a stale epoch: one far and one near deadline, armed while the scheduler was idle.
+template <class Queue>
+static bool checkStaleEpoch() {
+  Pair<Queue>* pair = new Pair<Queue>();
+  bool ok = true;
+  TinyVirtualClock::set(0x7FFF0000UL);        // a fresh scheduler, far from 0
+  pair->callIn(0, 100);
+  pair->callIn(1, 100000);
+  for (int step = 0; step < 4; step++) pair->idle(0x7FFFFFFFUL);
+  ok = ok && pair->mismatch() < 0;
+  delete pair;
+
+  pair = new Pair<Queue>();
+  TinyVirtualClock::set(0);
+  pair->callIn(0, 0x7FFF8000L);
+  pair->idle(0);
+  TinyVirtualClock::advance(0x7FFE0000UL);    // idle: no pass reaches the queue
+  pair->callIn(1, 100);
+  pair->callIn(2, 0x30000L);
+  for (int step = 0; step < 4; step++) pair->idle(0x7FFFFFFFUL);
+  ok = ok && pair->mismatch() < 0 && pair->alone[1].runs == 1;
+  delete pair;
+
+  pair = new Pair<Queue>();                   // 3000000000 fits a 64-bit long, but not the queues
+  TinyVirtualClock::set(0);
+  ok = ok && !pair->scheduled[0]->callEvery((long)3000000000UL) && !pair->scheduled[1]->callIn((long)0x80000000UL);
+  ok = ok && pair->scheduler.remaining(0) == -1;
+  delete pair;
+  return ok;
+}
+
+template <class Queue>
+static bool checkRandom(uint32_t runSeed) {
+  Pair<Queue>* pair = new Pair<Queue>();
+  seed = runSeed;
+  TinyVirtualClock::set(nextRandom());
+  bool ok = true;
+  for (int step = 0; step < QUEUECHECK_STEPS && ok; step++) {
+    uint32_t r = nextRandom();
+    int i = (r >> 8) % QUEUECHECK_TASKS;
+    switch (r & 7) {
+      case 0:
+      case 1:
+        pair->callIn(i, randomTime());
+        break;
+      case 2:
+        pair->callEvery(i, randomTime());
+        break;
+      case 3:
+        pair->cancel(i);
+        break;
+      default:
+        break;
+    }
+    pair->idle((r >> 16) & 1 ? randomTime() : (r >> 17) % 4);
+    ok = pair->mismatch() < 0;
+  }
+  delete pair;
+  return ok;
+}
+
+template <class Queue>
+static bool check(const char* name) {
+  int failed = 0;
+  bool stale = checkStaleEpoch<Queue>();
+  for (uint32_t s = 1; s <= QUEUECHECK_SEEDS; s++) {
+    if (!checkRandom<Queue>(s * 2654435761UL)) failed++;
+  }
+  printf("%-20s stale epoch: %s, random runs: %d of %d failed\n", name, stale ? "ok" : "FAILED", failed, QUEUECHECK_SEEDS);
+  return stale && failed == 0;
+}
+
+int main() {
+  bool ok = true;
+  ok &= check<TinyLinearQueue<QUEUECHECK_TASKS> >("TinyLinearQueue");
+  ok &= check<TinyDeltaQueue<QUEUECHECK_TASKS> >("TinyDeltaQueue");
+  ok &= check<TinyHeapQueue<QUEUECHECK_TASKS> >("TinyHeapQueue");
+  ok &= check<TinyRadixHeap<QUEUECHECK_TASKS> >("TinyRadixHeap");
+  ok &= check<TinyCalendarQueue<QUEUECHECK_TASKS> >("TinyCalendarQueue");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+/*
+ * Arduino.h - Just enough of the Arduino core to build TinyTask on a computer, for TinyAnalyser.
+ *
+ * millis() and micros() read TinyVirtualClock, which counts microseconds here, so the library's
+ * own timing (TinyTask::timeCalls()) measures simulated time too.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TINYVIRTUALCLOCK_HZ 1000000UL         // one virtual tick is one simulated microsecond
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * TinyAnalyser.cpp - Simulates a set of periodic tasks on the real TinyScheduler, on a computer.
+ *
+ * Reads a task set, runs it in simulated time on the same TinyScheduler and TinyTask code a sketch
+ * uses, and reports, for each task, how late it started and how long it took to finish (its
+ * response time) at worst, along with a histogram of lateness and the processor utilisation.
+ *
+ * The scheduler runs on TinyVirtualClock, ticking in microseconds. Each time a task runs, the
+ * clock is moved on by the task's WCET, so tasks that fall due together wait for each other just
+ * as they would on the board: TinyTask is cooperative, so a task that is due waits for whatever
+ * is running to finish. When nothing is due, the clock jumps to the next deadline.
+ *
+ * BUILD (from the library folder):
+
+g++ -std=gnu++11 -O2 -I extras/TinyAnalyser -I . extras/TinyAnalyser/TinyAnalyser.cpp TinyTask.cpp -o tinyanalyser
+
+ * USAGE:
+
+./tinyanalyser [-d duration] [-l loop_overhead] [taskset.txt]
+
+ * The task set is read from the file, or from standard input. Each line describes one task:
+
+# name      period   wcet    priority  offset
+sensor      10ms     1200us  0         0
+filter      20ms     3ms     1         5ms
+display     100ms    15ms    2
+
+ * Times are microseconds, or take a us, ms or s suffix. priority and offset are optional (0 by
+ * default). Tasks due at the same time run in priority order, lowest number first, which is the
+ * order they are given places in the scheduler's table. offset delays the task's first run; after
+ * that it runs every period, on multiples of period past offset (see callEveryAligned()).
+ *
+ * -d sets how much time to simulate (default: twice the hyperperiod plus the largest offset, at
+ * least 1 s and at most 60 s). -l adds a fixed cost for each pass of the main loop.
+ *
+ * A task whose response time is longer than its period misses its deadline. The report counts
+ * those, and the periods skipped altogether because the task was still waiting to run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "TinyScheduler.h"
+
+#define TINYANALYSER_TASKS 64                 // the most tasks in a task set
+#define TINYANALYSER_BUCKETS 33               // lateness histogram: 0, then one bucket per power of two
+
+struct Job {
+  char name[24];
+  unsigned long period;                       // in microseconds, like everything else here
+  unsigned long wcet;
+  unsigned long offset;
+  int priority;
+  TinyTask* task;
+  unsigned long runs;
+  unsigned long missed;                       // periods skipped to catch up
+  unsigned long overruns;                     // runs that finished after the next period began
+  long worstLateness;
+  unsigned long worstResponse;
+};
+
+static Job jobs[TINYANALYSER_TASKS];
+static int jobCount = 0;
+static unsigned long histogram[TINYANALYSER_BUCKETS];
+static unsigned long busy = 0;                // simulated microseconds spent in tasks
+
+TinyScheduler<TINYANALYSER_TASKS, TinyLinearQueue<TINYANALYSER_TASKS>, TinyVirtualClock> scheduler;
+
+unsigned long millis() {
+  return TinyVirtualClock::now() / 1000;
+}
+
+unsigned long micros() {
+  return TinyVirtualClock::now();
+}
+
+// Every task runs this, with its Job as the pointer parameter.
+static void runJob(const TinyTaskContext& run) {
+  Job* job = (Job*)run.pointerParam;
+  long lateness = TinyVirtualClock::now() - run.scheduled;   // run.now is when loop() began, before earlier tasks ran
+  TinyVirtualClock::advance(job->wcet);       // the task takes its WCET
+  busy += job->wcet;
+  unsigned long response = TinyVirtualClock::now() - run.scheduled;
+  job->runs++;
+  job->missed += run.missed;
+  if (response > job->period) job->overruns++;
+  if (lateness > job->worstLateness) job->worstLateness = lateness;
+  if (response > job->worstResponse) job->worstResponse = response;
+  uint8_t bucket = 0;
+  for (unsigned long late = lateness > 0 ? lateness : 0; late != 0; late >>= 1) bucket++;
+  histogram[bucket]++;
+}
+
+// Parses "250", "250us", "10ms" or "2s" into microseconds; false if it isn't a time.
+static bool parseTime(const char* text, unsigned long* micros) {
+  char* end;
+  double value = strtod(text, &end);
+  if (end == text || value < 0) return false;
+  if (*end == '\0' || strcmp(end, "us") == 0) {
+    *micros = (unsigned long)value;
+  } else if (strcmp(end, "ms") == 0) {
+    *micros = (unsigned long)(value * 1000);
+  } else if (strcmp(end, "s") == 0) {
+    *micros = (unsigned long)(value * 1000000);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool readTaskSet(FILE* in) {
+  char line[256];
+  int lineNumber = 0;
+  while (fgets(line, sizeof(line), in) != NULL) {
+    lineNumber++;
+    char* hash = strchr(line, '#');
+    if (hash != NULL) *hash = '\0';
+    char name[24], period[32], wcet[32], offset[32] = "0";
+    int priority = 0;
+    int fields = sscanf(line, "%23s %31s %31s %d %31s", name, period, wcet, &priority, offset);
+    if (fields <= 0) continue;                // blank or comment
+    if (jobCount == TINYANALYSER_TASKS) {
+      fprintf(stderr, "line %d: more than %d tasks\n", lineNumber, TINYANALYSER_TASKS);
+      return false;
+    }
+    Job* job = &jobs[jobCount];
+    memset(job, 0, sizeof(Job));
+    strcpy(job->name, name);
+    job->priority = fields >= 4 ? priority : 0;
+    if (fields < 3 || !parseTime(period, &job->period) || !parseTime(wcet, &job->wcet)
+        || !parseTime(offset, &job->offset) || job->period == 0) {
+      fprintf(stderr, "line %d: expected name, period, wcet[, priority[, offset]]\n", lineNumber);
+      return false;
+    }
+    jobCount++;
+  }
+  return jobCount > 0;
+}
+
+static unsigned long long greatestDivisor(unsigned long long a, unsigned long long b) {
+  while (b != 0) {
+    unsigned long long r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+static void printReport(unsigned long simulated) {
+  printf("%-16s %10s %10s %4s %10s %8s %7s %8s %12s %12s\n",
+         "task", "period", "wcet", "prio", "offset", "runs", "missed", "overruns", "worst late", "worst resp");
+  for (int i = 0; i < jobCount; i++) {
+    Job* job = &jobs[i];
+    printf("%-16s %8luus %8luus %4d %8luus %8lu %7lu %8lu %10ldus %10luus%s\n",
+           job->name, job->period, job->wcet, job->priority, job->offset, job->runs, job->missed,
+           job->overruns, job->worstLateness, job->worstResponse,
+           job->worstResponse > job->period ? "  MISSES DEADLINE" : "");
+  }
+  printf("\nsimulated %.3f s\n", simulated / 1e6);
+  printf("utilisation, from WCETs: %.2f%%\n", scheduler.utilisation() / 1e4);
+  printf("processor busy:          %.2f%%\n", simulated == 0 ? 0.0 : 100.0 * busy / simulated);
+  printf("\nlateness of each run\n");
+  unsigned long most = 1;
+  for (int b = 0; b < TINYANALYSER_BUCKETS; b++) {
+    if (histogram[b] > most) most = histogram[b];
+  }
+  for (int b = 0; b < TINYANALYSER_BUCKETS; b++) {
+    if (histogram[b] == 0) continue;
+    unsigned long low = b == 0 ? 0 : 1UL << (b - 1);
+    unsigned long high = b == 0 ? 0 : (1UL << b) - 1;
+    printf("%10lu-%-10lu us %10lu ", low, high, histogram[b]);
+    for (unsigned long bar = 0; bar < histogram[b] * 40 / most; bar++) putchar('#');
+    putchar('\n');
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned long duration = 0;
+  unsigned long loopOverhead = 0;
+  const char* path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      if (!parseTime(argv[++i], &duration)) return fprintf(stderr, "bad duration\n"), 2;
+    } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      if (!parseTime(argv[++i], &loopOverhead)) return fprintf(stderr, "bad loop overhead\n"), 2;
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: %s [-d duration] [-l loop_overhead] [taskset.txt]\n", argv[0]);
+      return 2;
+    } else {
+      path = argv[i];
+    }
+  }
+  FILE* in = path == NULL ? stdin : fopen(path, "r");
+  if (in == NULL) {
+    perror(path);
+    return 2;
+  }
+  if (!readTaskSet(in)) {
+    if (jobCount == 0) fprintf(stderr, "no tasks\n");
+    return 2;
+  }
+  if (in != stdin) fclose(in);
+
+  // Stable sort by priority, so equal priorities keep the order they were listed in.
+  for (int i = 1; i < jobCount; i++) {
+    Job job = jobs[i];
+    int j = i;
+    while (j > 0 && jobs[j - 1].priority > job.priority) {
+      jobs[j] = jobs[j - 1];
+      j--;
+    }
+    jobs[j] = job;
+  }
+
+  if (duration == 0) {
+    unsigned long long hyperperiod = 1;
+    unsigned long latest = 0;
+    for (int i = 0; i < jobCount; i++) {
+      hyperperiod = hyperperiod / greatestDivisor(hyperperiod, jobs[i].period) * jobs[i].period;
+      if (hyperperiod > 60000000ULL) hyperperiod = 60000000ULL;
+      if (jobs[i].offset > latest) latest = jobs[i].offset;
+    }
+    unsigned long long span = 2 * hyperperiod + latest;
+    duration = span < 1000000ULL ? 1000000UL : span > 60000000ULL ? 60000000UL : (unsigned long)span;
+  }
+
+  TinyVirtualClock::set(0);
+  for (int i = 0; i < jobCount; i++) {
+    Job* job = &jobs[i];
+    job->task = new TinyTaskPlus(runJob);
+    scheduler.add(*job->task);
+    job->task->setCost(job->wcet);
+    job->task->callEveryAligned((long)job->period, job->offset, job);
+  }
+
+  while (TinyVirtualClock::now() < duration) {
+    scheduler.loop();
+    TinyVirtualClock::advance(loopOverhead);
+    long wait = scheduler.remaining();
+    if (wait > 0) TinyVirtualClock::advance((unsigned long)wait);   // idle until the next task is due
+  }
+  printReport(TinyVirtualClock::now());
+  return 0;
+}